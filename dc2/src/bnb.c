@@ -1,16 +1,24 @@
 #include "bnb.h"
 
+double bnb_upper_bound(const rundata *run, const solution *sol, int *assigns_buffer){
+    if(run->dual_bound!=NULL) return dualbound_solution(run->dual_bound,run->prob,sol,assigns_buffer);
+    return solution_upper_bound(run,sol);
+}
+
 void branch_and_bound(rundata *run, solution **sols, int *n_sols){
-    // Update lower bound
+    const problem *prob = run->prob;
+    // Update lower bound, with the solutions that satisfy the size restriction
     for(int i=0;i<*n_sols;i++){
+        if(prob->size_restriction_minimum!=-1 && sols[i]->n_facs<prob->size_restriction_minimum) continue;
         if(sols[i]->value > run->bnb_lower_bound){
             run->bnb_lower_bound = sols[i]->value;
         }
     }
     // Filters solutions with larger upperbound
+    int *assigns_buffer = safe_malloc(sizeof(int)*prob->n_clis);
     int n_sols2 = 0;
     for(int i=0;i<*n_sols;i++){
-        double upbound = solution_upper_bound(run,sols[i]);
+        double upbound = bnb_upper_bound(run,sols[i],assigns_buffer);
         if(upbound < run->bnb_lower_bound){
             // Delete solution
             solution_free(sols[i]);
@@ -20,5 +28,7 @@ void branch_and_bound(rundata *run, solution **sols, int *n_sols){
             n_sols2 += 1;
         }
     }
+    free(assigns_buffer);
+    run->run_inf->n_bnb_pruned += *n_sols - n_sols2;
     *n_sols = n_sols2;
 }
@@ -4,7 +4,14 @@
 #include "utils.h"
 #include "problem.h"
 #include "solution.h"
+#include "dualbound.h"
 
+// Upper bound for the value of any solution that contains the facilities of sol.
+// Uses the dual bounds if they were computed, otherwise the optimal gain of each client.
+// assigns_buffer is an array of size prob->n_clis.
+double bnb_upper_bound(const rundata *run, const solution *sol, int *assigns_buffer);
+
+// Updates the lower bound and deletes the solutions that can't lead to a better one
 void branch_and_bound(rundata *run, solution **sols, int *n_sols);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,228 @@
+#include "checkpoint.h"
+
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC 0x54504b4332434400LL
+#define CHECKPOINT_VERSION 3
+
+// Writes n elements of the given size, checking for errors
+void ckpt_write(FILE *fp, const void *ptr, size_t size, size_t n){
+    if(n==0) return;
+    if(fwrite(ptr,size,n,fp)!=n){
+        fprintf(stderr,"ERROR: couldn't write checkpoint!\n");
+        exit(1);
+    }
+}
+
+// Reads n elements of the given size, checking for errors
+void ckpt_read(FILE *fp, void *ptr, size_t size, size_t n){
+    if(n==0) return;
+    if(fread(ptr,size,n,fp)!=n){
+        fprintf(stderr,"ERROR: checkpoint is truncated or corrupt!\n");
+        exit(1);
+    }
+}
+
+// Only the facilities of each solution are saved, the assignments are recomputed when loading
+void ckpt_write_solutions(FILE *fp, solution **sols, int n_sols){
+    ckpt_write(fp,&n_sols,sizeof(int),1);
+    for(int i=0;i<n_sols;i++){
+        ckpt_write(fp,&sols[i]->n_facs,sizeof(int),1);
+        ckpt_write(fp,sols[i]->facs,sizeof(int),sols[i]->n_facs);
+        ckpt_write(fp,&sols[i]->terminal,sizeof(int),1);
+    }
+}
+
+solution **ckpt_read_solutions(FILE *fp, const problem *prob, int *n_sols, int min_size){
+    ckpt_read(fp,n_sols,sizeof(int),1);
+    int size = *n_sols>min_size? *n_sols : min_size;
+    solution **sols = safe_malloc(sizeof(solution *)*(size>0? size : 1));
+    int *facs = safe_malloc(sizeof(int)*(prob->n_facs+1));
+    for(int i=0;i<*n_sols;i++){
+        int n_facs;
+        ckpt_read(fp,&n_facs,sizeof(int),1);
+        if(n_facs<0 || n_facs>prob->n_facs){
+            fprintf(stderr,"ERROR: checkpoint is truncated or corrupt!\n");
+            exit(1);
+        }
+        ckpt_read(fp,facs,sizeof(int),n_facs);
+        sols[i] = solution_empty(prob);
+        for(int k=0;k<n_facs;k++) solution_add(prob,sols[i],facs[k],NULL);
+        ckpt_read(fp,&sols[i]->terminal,sizeof(int),1);
+    }
+    free(facs);
+    return sols;
+}
+
+// Hash of the settings that change the search, a checkpoint can only be resumed with the same ones
+uint64_t ckpt_config_hash(const rundata *run, const redstrategy *rstrats, int n_rstrats){
+    const problem *prob = run->prob;
+    int settings[] = {
+        run->filter, run->local_search, run->local_search_pr, run->select_only_terminal,
+        run->local_search_before_select, run->local_search_rem_movement, run->local_search_add_movement,
+        run->branching_factor, run->branching_correction, run->path_relinking, run->pr_partners,
+        run->pr_round_robin, run->branch_and_bound, run->parallel_restarts, run->n_init_sols,
+        run->init_local_search, run->init_start, prob->size_restriction_minimum, prob->size_restriction_maximum,
+    };
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *bytes = (const unsigned char *) settings;
+    for(size_t k=0;k<sizeof(settings);k++) h = (h^bytes[k])*0x100000001b3ULL;
+    bytes = (const unsigned char *) &run->pr_truncate;
+    for(size_t k=0;k<sizeof(double);k++) h = (h^bytes[k])*0x100000001b3ULL;
+    for(int i=0;i<n_rstrats;i++){
+        // The separator keeps "a" "bc" different from "ab" "c"
+        for(const char *c=rstrats[i].nomenclature;*c;c++) h = (h^(unsigned char)*c)*0x100000001b3ULL;
+        h = (h^' ')*0x100000001b3ULL;
+    }
+    return h;
+}
+
+void checkpoint_save(const char *file, const rundata *run, const redstrategy *rstrats, int n_rstrats,
+        const checkpoint *ckpt){
+    const problem *prob = run->prob;
+    const runinfo *rinf = run->run_inf;
+    char *tmp_file = safe_malloc(strlen(file)+5);
+    sprintf(tmp_file,"%s.tmp",file);
+    FILE *fp = fopen(tmp_file,"wb");
+    if(fp==NULL){
+        fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",tmp_file);
+        exit(1);
+    }
+    // Header, to check that the checkpoint belongs to the same run
+    long long magic = CHECKPOINT_MAGIC;
+    int header[6] = {CHECKPOINT_VERSION,prob->n_facs,prob->n_clis,run->random_seed,run->n_restarts,run->target_sols};
+    uint64_t config_hash = ckpt_config_hash(run,rstrats,n_rstrats);
+    ckpt_write(fp,&magic,sizeof(long long),1);
+    ckpt_write(fp,header,sizeof(int),6);
+    ckpt_write(fp,&config_hash,sizeof(uint64_t),1);
+    // Search time so far
+    double elapsed = rundata_elapsed(run);
+    double cpu = (double)(clock() - run->start_clock) / (double)CLOCKS_PER_SEC;
+    ckpt_write(fp,&elapsed,sizeof(double),1);
+    ckpt_write(fp,&cpu,sizeof(double),1);
+    // Search state
+    ckpt_write(fp,&ckpt->restart,sizeof(int),1);
+    ckpt_write(fp,&ckpt->in_restart,sizeof(int),1);
+    ckpt_write(fp,&ckpt->csize,sizeof(int),1);
+    ckpt_write(fp,&ckpt->restart_seconds,sizeof(double),1);
+    ckpt_write(fp,ckpt->rngen.s,sizeof(uint64_t),4);
+    ckpt_write(fp,&run->bnb_lower_bound,sizeof(double),1);
+    ckpt_write_solutions(fp,ckpt->pool,ckpt->n_pool);
+    ckpt_write_solutions(fp,ckpt->selectpool,ckpt->n_selectpool);
+    ckpt_write_solutions(fp,ckpt->final,ckpt->n_final);
+    // Run info
+    ckpt_write(fp,&rinf->firstr_n_iterations,sizeof(int),1);
+    ckpt_write(fp,rinf->firstr_per_size_n_sols,sizeof(int),prob->n_facs+2);
+    ckpt_write(fp,rinf->firstr_per_size_n_sols_after_red,sizeof(int),prob->n_facs+2);
+    ckpt_write(fp,rinf->firstr_per_size_n_local_optima,sizeof(int),prob->n_facs+2);
+    ckpt_write(fp,&rinf->total_n_iterations,sizeof(int),1);
+    ckpt_write(fp,&rinf->n_local_searches,sizeof(long long int),1);
+    ckpt_write(fp,&rinf->n_local_search_movements,sizeof(long long int),1);
+    ckpt_write(fp,&rinf->local_search_seconds,sizeof(double),1);
+    ckpt_write(fp,rinf->restart_times,sizeof(double),run->n_restarts);
+    ckpt_write(fp,rinf->restart_values,sizeof(double),run->n_restarts);
+    ckpt_write(fp,&rinf->path_relinking_seconds,sizeof(double),1);
+    ckpt_write(fp,&rinf->n_bnb_pruned,sizeof(long long int),1);
+    ckpt_write(fp,&rinf->n_improvements,sizeof(int),1);
+    ckpt_write(fp,rinf->improvement_times,sizeof(double),rinf->n_improvements);
+    ckpt_write(fp,rinf->improvement_values,sizeof(double),rinf->n_improvements);
+    // Make sure that the data is on disk before replacing the previous checkpoint
+    if(fflush(fp)!=0 || fsync(fileno(fp))!=0){
+        fprintf(stderr,"ERROR: couldn't write checkpoint!\n");
+        exit(1);
+    }
+    fclose(fp);
+    if(rename(tmp_file,file)!=0){
+        fprintf(stderr,"ERROR: couldn't replace file \"%s\"!\n",file);
+        exit(1);
+    }
+    free(tmp_file);
+}
+
+checkpoint *checkpoint_load(const char *file, rundata *run, const redstrategy *rstrats, int n_rstrats){
+    const problem *prob = run->prob;
+    runinfo *rinf = run->run_inf;
+    FILE *fp = fopen(file,"rb");
+    if(fp==NULL) return NULL;
+    // Check the header
+    long long magic;
+    ckpt_read(fp,&magic,sizeof(long long),1);
+    int version;
+    ckpt_read(fp,&version,sizeof(int),1);
+    if(magic!=CHECKPOINT_MAGIC || version!=CHECKPOINT_VERSION){
+        fprintf(stderr,"ERROR: \"%s\" is not a valid checkpoint!\n",file);
+        exit(1);
+    }
+    int header[6];
+    header[0] = version;
+    ckpt_read(fp,&header[1],sizeof(int),5);
+    uint64_t config_hash;
+    ckpt_read(fp,&config_hash,sizeof(uint64_t),1);
+    if(header[1]!=prob->n_facs || header[2]!=prob->n_clis || header[4]!=run->n_restarts){
+        fprintf(stderr,"ERROR: checkpoint \"%s\" is from a different problem or number of restarts!\n",file);
+        exit(1);
+    }
+    if(header[5]!=run->target_sols || config_hash!=ckpt_config_hash(run,rstrats,n_rstrats)){
+        fprintf(stderr,"ERROR: checkpoint \"%s\" is from a different number of solutions or search configuration!\n",file);
+        exit(1);
+    }
+    // Continue with the seed of the interrupted run
+    run->random_seed = header[3];
+    // Continue counting the search time from where it was
+    double elapsed, cpu;
+    ckpt_read(fp,&elapsed,sizeof(double),1);
+    ckpt_read(fp,&cpu,sizeof(double),1);
+    long long elapsed_us = (long long)(elapsed*1e6);
+    run->start_time.tv_sec  -= elapsed_us/1000000;
+    run->start_time.tv_usec -= elapsed_us%1000000;
+    if(run->start_time.tv_usec<0){
+        run->start_time.tv_usec += 1000000;
+        run->start_time.tv_sec  -= 1;
+    }
+    run->start_clock -= (clock_t)(cpu*CLOCKS_PER_SEC);
+    // Search state
+    checkpoint *ckpt = safe_malloc(sizeof(checkpoint));
+    ckpt_read(fp,&ckpt->restart,sizeof(int),1);
+    ckpt_read(fp,&ckpt->in_restart,sizeof(int),1);
+    ckpt_read(fp,&ckpt->csize,sizeof(int),1);
+    ckpt_read(fp,&ckpt->restart_seconds,sizeof(double),1);
+    ckpt_read(fp,ckpt->rngen.s,sizeof(uint64_t),4);
+    ckpt_read(fp,&run->bnb_lower_bound,sizeof(double),1);
+    ckpt->pool       = ckpt_read_solutions(fp,prob,&ckpt->n_pool,0);
+    ckpt->selectpool = ckpt_read_solutions(fp,prob,&ckpt->n_selectpool,0);
+    ckpt->final      = ckpt_read_solutions(fp,prob,&ckpt->n_final,run->target_sols+1);
+    if(ckpt->n_final>run->target_sols){
+        fprintf(stderr,"ERROR: checkpoint is truncated or corrupt!\n");
+        exit(1);
+    }
+    // Run info
+    ckpt_read(fp,&rinf->firstr_n_iterations,sizeof(int),1);
+    ckpt_read(fp,rinf->firstr_per_size_n_sols,sizeof(int),prob->n_facs+2);
+    ckpt_read(fp,rinf->firstr_per_size_n_sols_after_red,sizeof(int),prob->n_facs+2);
+    ckpt_read(fp,rinf->firstr_per_size_n_local_optima,sizeof(int),prob->n_facs+2);
+    ckpt_read(fp,&rinf->total_n_iterations,sizeof(int),1);
+    ckpt_read(fp,&rinf->n_local_searches,sizeof(long long int),1);
+    ckpt_read(fp,&rinf->n_local_search_movements,sizeof(long long int),1);
+    ckpt_read(fp,&rinf->local_search_seconds,sizeof(double),1);
+    ckpt_read(fp,rinf->restart_times,sizeof(double),run->n_restarts);
+    ckpt_read(fp,rinf->restart_values,sizeof(double),run->n_restarts);
+    ckpt_read(fp,&rinf->path_relinking_seconds,sizeof(double),1);
+    ckpt_read(fp,&rinf->n_bnb_pruned,sizeof(long long int),1);
+    int n_improvements;
+    ckpt_read(fp,&n_improvements,sizeof(int),1);
+    double *imp_times  = safe_malloc(sizeof(double)*(n_improvements+1));
+    double *imp_values = safe_malloc(sizeof(double)*(n_improvements+1));
+    ckpt_read(fp,imp_times,sizeof(double),n_improvements);
+    ckpt_read(fp,imp_values,sizeof(double),n_improvements);
+    rinf->n_improvements = 0;
+    for(int i=0;i<n_improvements;i++) runinfo_add_improvement(rinf,imp_times[i],imp_values[i]);
+    free(imp_times);
+    free(imp_values);
+    fclose(fp);
+    return ckpt;
+}
+
+void checkpoint_free(checkpoint *ckpt){
+    free(ckpt);
+}
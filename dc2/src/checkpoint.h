@@ -0,0 +1,50 @@
+#ifndef DC_CHECKPOINT_H
+#define DC_CHECKPOINT_H
+
+#include "utils.h"
+#include "problem.h"
+#include "solution.h"
+#include "rundata.h"
+#include "shuffle.h"
+#include "redstrategy.h"
+
+// State of the search at the start of a generation (after its reductions) or between restarts,
+// from which it can be resumed.
+typedef struct {
+    // | Restart being performed (or the next one, if not in_restart)
+    int restart;
+    // | If the checkpoint was taken in the middle of the restart
+    int in_restart;
+    // | Size of the solutions in the current generation
+    int csize;
+    // | Time spent on the restart so far
+    double restart_seconds;
+    // | Random number generator of the restart
+    ranxoshi256 rngen;
+    // | Current generation, already reduced
+    solution **pool;
+    int n_pool;
+    // | Solutions selected on the restart so far
+    solution **selectpool;
+    int n_selectpool;
+    // | Best solutions found so far, sorted by decreasing value
+    solution **final;
+    int n_final;
+} checkpoint;
+
+// Saves the checkpoint and the runinfo to the given file.
+// A temporary file is written and then renamed, so the file is never left incomplete.
+// The header identifies the problem, the number of restarts and solutions, and the search configuration
+// (including the reduction strategies).
+void checkpoint_save(const char *file, const rundata *run, const redstrategy *rstrats, int n_rstrats,
+        const checkpoint *ckpt);
+
+// Loads a checkpoint from the given file, restoring the runinfo, lower bound and random seed of run.
+// Returns NULL if the file doesn't exist, exits if it is from a different problem or configuration.
+// The final array has size run->target_sols+1.
+checkpoint *checkpoint_load(const char *file, rundata *run, const redstrategy *rstrats, int n_rstrats);
+
+// Frees a checkpoint, but not the solutions or solution arrays in it.
+void checkpoint_free(checkpoint *ckpt);
+
+#endif
@@ -1,18 +1,32 @@
 #include "construction.h"
+#include "output.h"
+#include "checkpoint.h"
+#include "profiler.h"
 
 typedef struct {
-    // Best solutions found so far, to be retrieved.
-    solution **final; // NOTE: This array is expected to have a size of 2*prob->target_sols
-    int n_final;
+    // Best solutions found so far, to be retrieved, sorted by decreasing value.
+    solution **sols; // NOTE: This array is expected to have a size of at least prob->target_sols+1
+    int n_sols;
+    // Lock to access them, as restarts may be performed in parallel.
+    pthread_mutex_t mutex;
+    // The main rundata, that registers the improvements of the best solution
+    const rundata *run;
+    // Elapsed seconds when the last checkpoint was saved
+    double last_checkpoint;
+} finalsols;
+
+typedef struct {
+    // Best solutions found so far, shared between restarts.
+    finalsols *final;
     // Solutions that have been selected in the current iteration
     solution **selectpool;
     int n_selectpool;
 } solmemory;
 
 // Apply local search on selected solutions and then delete repeated
-void solmem_local_search_and_delete_repeated(rundata *run, solmemory *solmem){
+void solmem_local_search_and_delete_repeated(rundata *run, solmemory *solmem, int generation){
     if(run->verbose) printf("Performing LS on \033[34;1m%d\033[0m selected solutions.\n",solmem->n_selectpool);
-    solutions_hill_climbing(run,solmem->selectpool,solmem->n_selectpool);
+    solutions_hill_climbing(run,solmem->selectpool,solmem->n_selectpool,generation);
     // Delete repeated solutions after local search
     int n_prpool0 = solmem->n_selectpool;
     solutions_sort_and_delete_repeated(solmem->selectpool,&solmem->n_selectpool);
@@ -60,6 +74,56 @@ void update_selected_solutions(rundata *run, solmemory *solmem,
     free(cands);
 }
 
+// Inserts a solution in the final array, which is kept sorted by decreasing value, without repeated solutions
+// and with at most run->target_sols solutions. The solution is freed if it doesn't make it into the array.
+// NOTE: final->mutex must be held.
+void finalsols_insert(rundata *run, finalsols *final, solution *sol){
+    // Discard the solution if the final array is full and it is not better than the worst one
+    if(final->n_sols>=run->target_sols && sol->value<=final->sols[final->n_sols-1]->value){
+        solution_free(sol);
+        return;
+    }
+    // Discard the solution if it is repeated
+    for(int i=0;i<final->n_sols;i++){
+        if(solutionp_facs_cmp(&final->sols[i],&sol)==0){
+            solution_free(sol);
+            return;
+        }
+    }
+    // Insert the solution on its place
+    int place = final->n_sols;
+    while(place>0 && final->sols[place-1]->value < sol->value){
+        final->sols[place] = final->sols[place-1];
+        place--;
+    }
+    final->sols[place] = sol;
+    final->n_sols += 1;
+    // Drop the worst solution if there are too many
+    if(final->n_sols>run->target_sols){
+        solution_free(final->sols[final->n_sols-1]);
+        final->n_sols -= 1;
+    }
+}
+
+// Registers an improvement of the best final solution, if there is one, and updates the lower bound.
+// NOTE: final->mutex must be held.
+void finalsols_inserted(rundata *run, finalsols *final){
+    if(final->n_sols==0) return;
+    // Register improvements of the best solution, saving it if requested
+    runinfo *main_inf = final->run->run_inf;
+    double last_best = main_inf->n_improvements==0? -INFINITY : main_inf->improvement_values[main_inf->n_improvements-1];
+    if(final->sols[0]->value > last_best){
+        runinfo_add_improvement(main_inf,rundata_seconds(final->run),final->sols[0]->value);
+        if(final->run->anytime_fname) save_best_so_far(final->run->anytime_fname,final->run,final->sols[0]);
+        runcallbacks *cbs = final->run->callbacks;
+        if(cbs!=NULL && cbs->improvement!=NULL) cbs->improvement(final->run,final->sols[0],cbs->data);
+    }
+    // Update the lower bound, the final solutions may also come from other restarts.
+    // With -p each restart only uses its own bound, which doesn't depend on the restarts already finished.
+    if(run->parallel_restarts) return;
+    if(final->sols[0]->value > run->bnb_lower_bound) run->bnb_lower_bound = final->sols[0]->value;
+}
+
 // Save selected solutions (copying) in the final array if they are better than the current ones on it.
 // Retrieves value of the best solution
 double solmemory_register_in_final(rundata *run, solmemory *solmem, int restart, int only_best){
@@ -79,82 +143,158 @@ double solmemory_register_in_final(rundata *run, solmemory *solmem, int restart,
             run->run_inf->restart_values[restart] = new_best_solution->value;
         }
 
+        finalsols *final = solmem->final;
         if(only_best){
             // Add best solution to the final solutions
-            solmem->final[solmem->n_final] = solution_copy(run->prob,new_best_solution);
-            solmem->n_final += 1;
+            solution *cand = solution_copy(run->prob,new_best_solution);
+            pthread_mutex_lock(&final->mutex);
+            finalsols_insert(run,final,cand);
         }else{
-            // Copy all selected solutions
-            int n_sel_cpy = solmem->n_selectpool;
-            solution **sel_cpy = safe_malloc(sizeof(solution *)*solmem->n_selectpool);
-            for(int i=0;i<n_sel_cpy;i++){
-                sel_cpy[i] = solution_copy(run->prob,solmem->selectpool[i]);
-            }
-
-            // Pick the best prob->target_sols candidates
-            reduction_bests(run,sel_cpy,&n_sel_cpy,run->target_sols);
-
+            // Pick the best prob->target_sols candidates, copying only them
+            solvalpair *pairs = new_solvalpairs(solmem->selectpool,solmem->n_selectpool);
+            int n_cands = solmem->n_selectpool<run->target_sols? solmem->n_selectpool : run->target_sols;
+            solvalpairs_select_bests(pairs,solmem->n_selectpool,n_cands);
+            solution **cands = safe_malloc(sizeof(solution *)*n_cands);
+            for(int i=0;i<n_cands;i++) cands[i] = solution_copy(run->prob,solmem->selectpool[pairs[i].indx]);
+            free(pairs);
             // Merge candidates with the final solutions
-            for(int i=0;i<n_sel_cpy;i++){
-                solmem->final[solmem->n_final] = sel_cpy[i];
-                solmem->n_final += 1;
-            }
-
-            // Copy of selecteds is not longer needed.
-            free(sel_cpy);
+            pthread_mutex_lock(&final->mutex);
+            for(int i=0;i<n_cands;i++) finalsols_insert(run,final,cands[i]);
+            free(cands);
         }
 
-        // Remove repeated solutions
-        solutions_sort_and_delete_repeated(solmem->final,&solmem->n_final);
-        // Pick the best prob->target_sols for final solutions
-        reduction_bests(run,solmem->final,&solmem->n_final,run->target_sols);
-        // Update the lower bound
-        if(solmem->final[0]->value > run->bnb_lower_bound) run->bnb_lower_bound = solmem->final[0]->value;
+        finalsols_inserted(run,final);
+        pthread_mutex_unlock(&final->mutex);
     }
 
     return new_best_sol_value;
 }
 
-solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rstrats,
-        int *out_n_sols){
+// Saves a checkpoint if checkpoints are enabled and the interval since the last one has passed.
+// The restart state is given if in the middle of restart r, otherwise r is the next restart.
+void construction_checkpoint(rundata *run, const redstrategy *rstrats, int n_rstrats, finalsols *final,
+        int r, int in_restart, double restart_seconds,
+        const ranxoshi256 *rngen, solution **pool, int n_pool, const solmemory *solmem){
+    if(run->checkpoint_interval<=0) return;
+    double elapsed = rundata_elapsed(final->run);
+    if(elapsed-final->last_checkpoint < run->checkpoint_interval) return;
+    checkpoint ckpt;
+    ckpt.restart         = r;
+    ckpt.in_restart      = in_restart;
+    ckpt.csize           = in_restart? pool[0]->n_facs : 0;
+    ckpt.restart_seconds = restart_seconds;
+    if(rngen) ckpt.rngen = *rngen;
+    else memset(&ckpt.rngen,0,sizeof(ranxoshi256));
+    ckpt.pool         = pool;
+    ckpt.n_pool       = n_pool;
+    ckpt.selectpool   = solmem? solmem->selectpool : NULL;
+    ckpt.n_selectpool = solmem? solmem->n_selectpool : 0;
+    pthread_mutex_lock(&final->mutex);
+    ckpt.final   = final->sols;
+    ckpt.n_final = final->n_sols;
+    checkpoint_save(run->checkpoint_fname,run,rstrats,n_rstrats,&ckpt);
+    pthread_mutex_unlock(&final->mutex);
+    final->last_checkpoint = elapsed;
+    if(run->verbose) printf("Saved checkpoint on \"%s\".\n",run->checkpoint_fname);
+}
 
-    const problem *prob = run->prob;
+// Adds copies of the initial solutions of the given size to a generation, without repeating solutions
+void add_initial_solutions(rundata *run, solution ***sols, int *n_sols, int size){
+    int n_sols0 = *n_sols;
+    for(int i=0;i<run->n_init_sols;i++){
+        if(run->init_sols[i]->n_facs!=size) continue;
+        *sols = safe_realloc(*sols,sizeof(solution *)*(*n_sols+1));
+        (*sols)[*n_sols] = solution_copy(run->prob,run->init_sols[i]);
+        *n_sols += 1;
+    }
+    if(*n_sols>n_sols0){
+        if(run->verbose) printf("Added \033[31;1m%d\033[0m initial solutions.\n",*n_sols-n_sols0);
+        solutions_sort_and_delete_repeated(*sols,n_sols);
+    }
+}
 
-    // Set random seed
-    srand(run->random_seed);
+// Performs the restart r, registering its best solutions in final.
+// If resume is not NULL, the restart continues from its state.
+void construction_restart(rundata *run, redstrategy *rstrats, int n_rstrats, finalsols *final, int r,
+        checkpoint *resume){
 
-    // The final solutions:
-    solmemory solmem;
-    solmem.n_final   = 0;
-    solmem.final     = safe_malloc(sizeof(solution *)*run->target_sols*2);
-
-    for(int r=0;r<run->n_restarts;r++){
+    const problem *prob = run->prob;
 
-        // Initialize terminal pool
-        solmem.n_selectpool  = 0;
-        solmem.selectpool    = safe_malloc(sizeof(solution *)*1);
+    // Random number generator for the reductions, a different stream for each restart
+    ranxoshi256 rngen;
+    if(resume) rngen = resume->rngen;
+    else rngen_seed_stream(&rngen,run->random_seed,r);
 
-        // Measure restart time
-        clock_t restart_start = clock();
+    // Initialize terminal pool
+    solmemory solmem;
+    solmem.final         = final;
+    if(resume){
+        solmem.n_selectpool = resume->n_selectpool;
+        solmem.selectpool   = resume->selectpool;
+    }else{
+        solmem.n_selectpool = 0;
+        solmem.selectpool   = safe_malloc(sizeof(solution *)*1);
+    }
 
-        int first_restart = r==0;
+    // Measure restart time (elapsed time of its thread when restarts are parallel)
+    clock_t restart_start = clock();
+    struct timeval restart_elapsed_start;
+    gettimeofday(&restart_elapsed_start,NULL);
+
+    // Time spent on the restart before resuming it
+    double restart_seconds0 = resume? resume->restart_seconds : 0;
+
+    int first_restart = r==0;
+
+    if(run->verbose) printf("\n== RESTART %d/%d ==\n",r+1,run->n_restarts);
+
+    // The previous generation
+    int prev_n_sols;
+    solution **prev_sols;
+    int csize; // Current solution size, last base computed
+    if(resume){
+        prev_n_sols = resume->n_pool;
+        prev_sols   = resume->pool;
+        csize       = resume->csize;
+    }else if(run->init_start && run->n_init_sols>0){
+        // Start from the initial solutions of the smallest size
+        prev_n_sols = 0;
+        prev_sols   = safe_malloc(sizeof(solution *)*1);
+        csize       = prob->n_facs;
+        for(int i=0;i<run->n_init_sols;i++){
+            if(run->init_sols[i]->n_facs<csize) csize = run->init_sols[i]->n_facs;
+        }
+        add_initial_solutions(run,&prev_sols,&prev_n_sols,csize);
+    }else{
+        prev_n_sols = 1;
+        prev_sols   = safe_malloc(sizeof(solution *)*prev_n_sols);
+        prev_sols[0] = solution_empty(prob);
+        csize       = 0;
+    }
 
-        if(run->verbose) printf("\n== RESTART %d/%d ==\n",r+1,run->n_restarts);
+    // A resumed generation was already reduced
+    int reduced = resume!=NULL;
 
-        // The previous generation
-        int prev_n_sols = 1;
-        solution **prev_sols = safe_malloc(sizeof(solution *)*prev_n_sols);
-        prev_sols[0] = solution_empty(prob);
+    while(prev_n_sols>0){
 
-        int csize = 0; // Current solution size, last base computed
-        while(prev_n_sols>0){
+        // Stop the expansion if the time is up, the current generation becomes terminal
+        if(rundata_time_is_up(run)){
+            if(run->verbose) printf("\nTime limit reached, stopping on size \033[32;1m%d\033[0m.\n",csize);
+            run->run_inf->time_limit_reached = 1;
+            for(int i=0;i<prev_n_sols;i++) prev_sols[i]->terminal = 1;
+            update_selected_solutions(run,&solmem,prev_sols,prev_n_sols,csize,r);
+            break;
+        }
 
-            if(run->verbose) printf("\nBase has \033[31;1m%d\033[0m solutions of size \033[32;1m%d\033[0m.\n",prev_n_sols,csize);
+        if(run->verbose) printf("\nBase has \033[31;1m%d\033[0m solutions of size \033[32;1m%d\033[0m.\n",prev_n_sols,csize);
 
+        if(!reduced){
             // Apply branch and bound
             if(run->branch_and_bound){
                 int n_sols0 = prev_n_sols;
+                uint64_t prof_start = profiler_begin(run->prof,PHASE_FILTER);
                 branch_and_bound(run,prev_sols,&prev_n_sols);
+                profiler_span(run->prof,PHASE_FILTER,prof_start,run->prof_set,0,csize,NULL);
                 if(prev_n_sols < n_sols0){
                     if(run->verbose) printf("Pruned \033[31;1m%d\033[0m -> \033[31;1m%d\033[0m solutions, by B&B.\n",n_sols0,prev_n_sols);
                 }
@@ -168,7 +308,9 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
             // Apply the reduction strategies
             for(int i=0;i<n_rstrats;i++){
                 if(!rstrats[i].for_selected_sols){ // Only apply reductions not intended for selected solutions
-                    reduce_by_redstrategy(run,rstrats[i],prev_sols,&prev_n_sols);
+                    uint64_t prof_start = profiler_begin(run->prof,PHASE_REDUCTION);
+                    reduce_by_redstrategy(run,rstrats[i],prev_sols,&prev_n_sols,&rngen);
+                    profiler_span(run->prof,PHASE_REDUCTION,prof_start,run->prof_set,0,csize,rstrats[i].nomenclature);
                 }
             }
 
@@ -176,149 +318,385 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
             if(first_restart && run->local_search){
                 run->run_inf->firstr_per_size_n_sols_after_red[csize] = prev_n_sols;
             }
+        }
+        reduced = 0;
 
-            // Expand solutions from the previous generation to create the next one
-            int next_n_sols = 0;
-            solution **next_sols = NULL;
-
-            if(csize<prob->n_facs && prev_n_sols>0){
-                if(prob->size_restriction_maximum==-1 || csize<prob->size_restriction_maximum){
-                    if(run->verbose) printf("Expanding \033[31;1m%d\033[0m solutions.\n",prev_n_sols);
-                    next_n_sols = prev_n_sols;
-                    // Get the final pool size expected at the end of each iteration
-                    int pool_size = prev_n_sols*prob->n_facs;
-                    for(int s=0;s<n_rstrats;s++){
-                        if(!rstrats[s].for_selected_sols) pool_size = rstrats[s].n_target;
-                    }
-                    // Expand solutions to get the next generation
-                    next_sols = new_expand_solutions(run,prev_sols,prev_n_sols,&next_n_sols,pool_size);
+        // Save a checkpoint from which the search can continue
+        if(prev_n_sols>0){
+            double restart_seconds = restart_seconds0 + (double)(clock() - restart_start) / (double)CLOCKS_PER_SEC;
+            construction_checkpoint(run,rstrats,n_rstrats,final,r,1,restart_seconds,&rngen,prev_sols,prev_n_sols,&solmem);
+        }
+
+        // Report the progress to the embedding program, the generation becomes terminal if it asks to stop
+        if(run->callbacks!=NULL && run->callbacks->progress!=NULL){
+            if(run->callbacks->progress(run,r,csize,prev_n_sols,run->callbacks->data)){
+                run->callbacks->stop = 1;
+                continue;
+            }
+        }
+
+        // Expand solutions from the previous generation to create the next one
+        int next_n_sols = 0;
+        solution **next_sols = NULL;
+
+        if(csize<prob->n_facs && prev_n_sols>0){
+            if(prob->size_restriction_maximum==-1 || csize<prob->size_restriction_maximum){
+                if(run->verbose) printf("Expanding \033[31;1m%d\033[0m solutions.\n",prev_n_sols);
+                next_n_sols = prev_n_sols;
+                // Get the final pool size expected at the end of each iteration
+                int pool_size = prev_n_sols*prob->n_facs;
+                for(int s=0;s<n_rstrats;s++){
+                    if(!rstrats[s].for_selected_sols) pool_size = rstrats[s].n_target;
                 }
+                // Expand solutions to get the next generation
+                next_sols = new_expand_solutions(run,prev_sols,prev_n_sols,&next_n_sols,pool_size,&rngen);
+            }
+        }
+
+        // Inject the initial solutions of the next size
+        if(csize<prob->n_facs) add_initial_solutions(run,&next_sols,&next_n_sols,csize+1);
+
+        // With a time limit, keep the best solution up to date for when the search stops
+        if(run->time_limit>0 && prev_n_sols>0){
+            // Only solutions of a size allowed by the size restrictions can be final
+            solution *best = NULL;
+            for(int i=0;i<prev_n_sols;i++){
+                int n_facs = prev_sols[i]->n_facs;
+                if(prob->size_restriction_minimum!=-1 && n_facs<prob->size_restriction_minimum) continue;
+                if(prob->size_restriction_maximum!=-1 && n_facs>prob->size_restriction_maximum) continue;
+                if(best==NULL || prev_sols[i]->value > best->value) best = prev_sols[i];
+            }
+            if(best!=NULL){
+                if(best->value > run->run_inf->restart_values[r]) run->run_inf->restart_values[r] = best->value;
+                pthread_mutex_lock(&final->mutex);
+                finalsols_insert(run,final,solution_copy(prob,best));
+                finalsols_inserted(run,final);
+                pthread_mutex_unlock(&final->mutex);
             }
+        }
 
-            // Add the prev generation solutions in the selected solutions and free their memory
-            update_selected_solutions(run,&solmem,prev_sols,prev_n_sols,csize,r);
+        // Add the prev generation solutions in the selected solutions and free their memory
+        update_selected_solutions(run,&solmem,prev_sols,prev_n_sols,csize,r);
 
-            // Now the current gen is the previous one
-            prev_n_sols = next_n_sols;
-            prev_sols = next_sols;
+        // Now the current gen is the previous one
+        prev_n_sols = next_n_sols;
+        prev_sols = next_sols;
 
-            // Increase csize
-            csize += 1;
-            // Update number of iterations
-            if(first_restart) run->run_inf->firstr_n_iterations = csize;
+        // Increase csize
+        csize += 1;
+        // Update number of iterations
+        if(first_restart) run->run_inf->firstr_n_iterations = csize;
 
-        }
-        run->run_inf->total_n_iterations += csize;
+    }
+    run->run_inf->total_n_iterations += csize;
 
-        if(run->verbose) printf("\nStarting final reduction with \033[34;1m%d\033[0m selected solutions:\n",solmem.n_selectpool);
+    if(run->verbose) printf("\nStarting final reduction with \033[34;1m%d\033[0m selected solutions:\n",solmem.n_selectpool);
 
-        { /* Operate on selected solutions */
+    { /* Operate on selected solutions */
 
-            // Apply local search to selected solutions if we are before final selections
-            if(run->local_search!=NO_LOCAL_SEARCH && run->local_search_before_select){
-                solmem_local_search_and_delete_repeated(run,&solmem);
-            }
+        // Apply local search to selected solutions if we are before final selections
+        if(run->local_search!=NO_LOCAL_SEARCH && run->local_search_before_select){
+            solmem_local_search_and_delete_repeated(run,&solmem,csize);
+        }
 
-            // Save best solution, just in case it is deleted in the reductions
-            solmemory_register_in_final(run,&solmem,r,1);
+        // Save best solution, just in case it is deleted in the reductions
+        solmemory_register_in_final(run,&solmem,r,1);
 
-            // Apply reduction to selected solutions
-            for(int i=0;i<n_rstrats;i++){
-                if(rstrats[i].for_selected_sols){
-                    reduce_by_redstrategy(run,rstrats[i],solmem.selectpool,&solmem.n_selectpool);
-                }
+        // Apply reduction to selected solutions
+        for(int i=0;i<n_rstrats;i++){
+            if(rstrats[i].for_selected_sols){
+                uint64_t prof_start = profiler_begin(run->prof,PHASE_REDUCTION);
+                reduce_by_redstrategy(run,rstrats[i],solmem.selectpool,&solmem.n_selectpool,&rngen);
+                profiler_span(run->prof,PHASE_REDUCTION,prof_start,run->prof_set,0,csize,rstrats[i].nomenclature);
             }
+        }
 
-            // Apply local search to selected solutions if we are before final selections
-            if(run->local_search!=NO_LOCAL_SEARCH && !run->local_search_before_select){
-                solmem_local_search_and_delete_repeated(run,&solmem);
-            }
+        // Apply local search to selected solutions if we are before final selections
+        if(run->local_search!=NO_LOCAL_SEARCH && !run->local_search_before_select){
+            solmem_local_search_and_delete_repeated(run,&solmem,csize);
         }
+    }
+
+    // Apply post-optimization to the selected solutions
+    if(run->path_relinking!=NO_PATH_RELINKING){
 
-        // Apply post-optimization to the selected solutions
-        if(run->path_relinking!=NO_PATH_RELINKING){
+        if(run->verbose) printf("\nStarting Post-optimization with \033[34;1m%d\033[0m selected solutions:\n",solmem.n_selectpool);
 
-            if(run->verbose) printf("\nStarting Post-optimization with \033[34;1m%d\033[0m selected solutions:\n",solmem.n_selectpool);
+        while(1){
 
-            while(1){
+            if(run->verbose) printf("\n");
 
-                if(run->verbose) printf("\n");
+            if(rundata_time_is_up(run)){
+                if(run->verbose) printf("Time limit reached, stopping post-optimization.\n");
+                run->run_inf->time_limit_reached = 1;
+                break;
+            }
 
-                // Find current best solution value
-                double prev_best_sol_value = solmemory_register_in_final(run,&solmem,r,1);
+            // Find current best solution value
+            double prev_best_sol_value = solmemory_register_in_final(run,&solmem,r,1);
 
-                // Apply the reduction strategies
-                for(int i=0;i<n_rstrats;i++){
-                    if(rstrats[i].for_selected_sols){ // Only apply reductions not intended for path relinking
-                        reduce_by_redstrategy(run,rstrats[i],solmem.selectpool,&solmem.n_selectpool);
-                    }
+            // Apply the reduction strategies
+            for(int i=0;i<n_rstrats;i++){
+                if(rstrats[i].for_selected_sols){ // Only apply reductions not intended for path relinking
+                    uint64_t prof_start = profiler_begin(run->prof,PHASE_REDUCTION);
+                    reduce_by_redstrategy(run,rstrats[i],solmem.selectpool,&solmem.n_selectpool,&rngen);
+                    profiler_span(run->prof,PHASE_REDUCTION,prof_start,run->prof_set,0,csize,rstrats[i].nomenclature);
                 }
+            }
 
-                // Perform path relinking on the terminal solutions
-                if(run->verbose) printf("Performing Path Relinking on \033[34;1m%d\033[0m solutions.\n",solmem.n_selectpool);
-                solutions_path_relinking(run,&solmem.selectpool,&solmem.n_selectpool);
+            // Perform path relinking on the terminal solutions
+            if(run->verbose) printf("Performing Path Relinking on \033[34;1m%d\033[0m solutions.\n",solmem.n_selectpool);
+            solutions_path_relinking(run,&solmem.selectpool,&solmem.n_selectpool,csize);
 
-                if(run->verbose) printf("PR resulted in \033[34;1m%d\033[0m different solutions.\n",solmem.n_selectpool);
+            if(run->verbose) printf("PR resulted in \033[34;1m%d\033[0m different solutions.\n",solmem.n_selectpool);
 
 
-                // Perform local search on the resulting solutions
-                if(run->local_search != NO_LOCAL_SEARCH){
+            // Perform local search on the resulting solutions (unless it was performed with the path relinking)
+            if(run->local_search != NO_LOCAL_SEARCH){
+                if(path_relinking_includes_local_search(run)){
+                    if(run->verbose) printf("LS was performed on \033[34;1m%d\033[0m resulting solutions.\n",solmem.n_selectpool);
+                }else{
                     if(run->verbose) printf("Performing LS on \033[34;1m%d\033[0m resulting solutions.\n",solmem.n_selectpool);
-                    solutions_hill_climbing(run,solmem.selectpool,solmem.n_selectpool);
-
-                    // Delete repeated solutions after local search
-                    int n_prpool0 = solmem.n_selectpool;
-                    solutions_sort_and_delete_repeated(solmem.selectpool,&solmem.n_selectpool);
-                    if(n_prpool0>solmem.n_selectpool){
-                        if(run->verbose) printf(
-                            "Reduced \033[34;1m%d\033[0m terminal solutions to \033[34;1m%d\033[0m local optima.\n",
-                            n_prpool0,solmem.n_selectpool);
-                    }
+                    solutions_hill_climbing(run,solmem.selectpool,solmem.n_selectpool,csize);
                 }
 
-                // Find new best solution value
-                double new_best_sol_value = solmemory_register_in_final(run,&solmem,r,1);
-
-                // Check for terminating conditions and save best solution found on this iteration
-                if(solmem.n_selectpool<=1) break;
-                // if(solmem.n_selectpool<=n_prpool_before_pr-1) break; // NOTE: Can this help?
-                if(run->path_relinking==PATH_RELINKING_1_ITER){
-                    // Make PR only happen once with PATH_RELINKING_1_STEP
-                    break;
-                }else if(run->path_relinking==PATH_RELINKING_UNTIL_NO_BETTER){
-                    // No better solution was found
-                    if(new_best_sol_value<=prev_best_sol_value) break;
+                // Delete repeated solutions after local search
+                int n_prpool0 = solmem.n_selectpool;
+                solutions_sort_and_delete_repeated(solmem.selectpool,&solmem.n_selectpool);
+                if(n_prpool0>solmem.n_selectpool){
+                    if(run->verbose) printf(
+                        "Reduced \033[34;1m%d\033[0m terminal solutions to \033[34;1m%d\033[0m local optima.\n",
+                        n_prpool0,solmem.n_selectpool);
                 }
+            }
 
+            // Find new best solution value
+            double new_best_sol_value = solmemory_register_in_final(run,&solmem,r,1);
+
+            // Check for terminating conditions and save best solution found on this iteration
+            if(solmem.n_selectpool<=1) break;
+            // if(solmem.n_selectpool<=n_prpool_before_pr-1) break; // NOTE: Can this help?
+            if(run->path_relinking==PATH_RELINKING_1_ITER){
+                // Make PR only happen once with PATH_RELINKING_1_STEP
+                break;
+            }else if(run->path_relinking==PATH_RELINKING_UNTIL_NO_BETTER){
+                // No better solution was found
+                if(new_best_sol_value<=prev_best_sol_value) break;
             }
+
         }
+    }
+
+    // Save best solutions in the final ones
+    solmemory_register_in_final(run,&solmem,r,0);
 
-        // Save best solutions in the final ones
-        solmemory_register_in_final(run,&solmem,r,0);
+    // Local searches may have been skipped
+    if(rundata_time_is_up(run)) run->run_inf->time_limit_reached = 1;
 
-        // Free selected pool
-        for(int i=0;i<solmem.n_selectpool;i++){
-            solution_free(solmem.selectpool[i]);
+    // Free selected pool
+    for(int i=0;i<solmem.n_selectpool;i++){
+        solution_free(solmem.selectpool[i]);
+    }
+    free(solmem.selectpool);
+
+    clock_t restart_end = clock();
+    struct timeval restart_elapsed_end;
+    gettimeofday(&restart_elapsed_end,NULL);
+    if(run->parallel_restarts){
+        run->run_inf->restart_times[r] = get_delta_seconds(restart_elapsed_start,restart_elapsed_end);
+    }else{
+        run->run_inf->restart_times[r] = restart_seconds0 + (double)(restart_end - restart_start) / (double)CLOCKS_PER_SEC;
+    }
+
+    if(run->verbose) printf("\n");
+}
+
+typedef struct {
+    // Copy of the rundata for this thread, with its own runinfo counters
+    rundata run;
+    runinfo run_inf;
+    redstrategy *rstrats;
+    int n_rstrats;
+    finalsols *final;
+    // Next restart to be performed, shared by all threads
+    int *next_restart;
+    pthread_mutex_t *next_restart_mutex;
+    double initial_lower_bound;
+    // Whether to report each finished restart
+    int verbose;
+} restart_thread_args;
+
+void *restart_thread_execution(void *arg){
+    restart_thread_args *args = (restart_thread_args *) arg;
+    rundata *run = &args->run;
+    while(1){
+        // Pick the next restart to be performed
+        pthread_mutex_lock(args->next_restart_mutex);
+        int r = *args->next_restart;
+        *args->next_restart += 1;
+        pthread_mutex_unlock(args->next_restart_mutex);
+        // Each restart starts from the initial lower bound, so its pruning doesn't depend on
+        // which restarts were already finished, and the results on the number of threads.
+        run->bnb_lower_bound = args->initial_lower_bound;
+        if(r>=run->n_restarts) break;
+        if(r>0 && rundata_time_is_up(run)){
+            run->run_inf->time_limit_reached = 1;
+            break;
         }
-        free(solmem.selectpool);
 
-        clock_t restart_end = clock();
-        run->run_inf->restart_times[r] = (double)(restart_end - restart_start) / (double)CLOCKS_PER_SEC;
+        construction_restart(run,args->rstrats,args->n_rstrats,args->final,r,NULL);
 
-        if(run->verbose) printf("\n");
+        pthread_mutex_lock(args->next_restart_mutex);
+        if(args->verbose) printf("Restart %d/%d done, best value %lf.\n",r+1,run->n_restarts,run->run_inf->restart_values[r]);
+        pthread_mutex_unlock(args->next_restart_mutex);
+    }
+    return NULL;
+}
 
+solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rstrats,
+        int *out_n_sols){
 
+    // Compute the dual bounds used by branch and bound
+    if(run->branch_and_bound && run->dual_bound==NULL){
+        run->dual_bound = dualbound_init(run->prob,run->verbose);
+    }
+
+    // The final solutions:
+    finalsols final;
+    final.n_sols = 0;
+    final.sols   = safe_malloc(sizeof(solution *)*(run->target_sols+1));
+    pthread_mutex_init(&final.mutex,NULL);
+    final.run = run;
+
+    // Register the initial solutions, so the results are never worse than them
+    if(run->n_init_sols>0){
+        if(run->init_local_search && run->local_search!=NO_LOCAL_SEARCH){
+            if(run->verbose) printf("\nPerforming LS on \033[34;1m%d\033[0m initial solutions.\n",run->n_init_sols);
+            solutions_hill_climbing(run,run->init_sols,run->n_init_sols,-1);
+            solutions_sort_and_delete_repeated(run->init_sols,&run->n_init_sols);
+        }
+        pthread_mutex_lock(&final.mutex);
+        for(int i=0;i<run->n_init_sols;i++) finalsols_insert(run,&final,solution_copy(run->prob,run->init_sols[i]));
+        finalsols_inserted(run,&final);
+        pthread_mutex_unlock(&final.mutex);
     }
+
+    // With -p, each restart starts from this lower bound, however the restarts are run
+    double initial_lower_bound = run->bnb_lower_bound;
+
+    if(run->parallel_restarts && run->n_threads>1 && run->n_restarts>1){
+        // Each thread performs whole restarts, with single threaded phases
+        int n_workers = run->n_threads<run->n_restarts? run->n_threads : run->n_restarts;
+        if(run->verbose) printf("\nPerforming %d restarts on %d threads.\n",run->n_restarts,n_workers);
+        int next_restart = 0;
+        pthread_mutex_t next_restart_mutex;
+        pthread_mutex_init(&next_restart_mutex,NULL);
+        pthread_t *threads = safe_malloc(sizeof(pthread_t)*n_workers);
+        restart_thread_args *targs = safe_malloc(sizeof(restart_thread_args)*n_workers);
+        for(int i=0;i<n_workers;i++){
+            // The runinfo shares the per-size and per-restart arrays, but has its own counters
+            targs[i].run_inf = *run->run_inf;
+            targs[i].run_inf.total_n_iterations       = 0;
+            targs[i].run_inf.n_local_searches         = 0;
+            targs[i].run_inf.n_local_search_movements = 0;
+            targs[i].run_inf.local_search_seconds     = 0;
+            targs[i].run_inf.path_relinking_seconds   = 0;
+            targs[i].run_inf.n_bnb_pruned             = 0;
+            targs[i].run = *run;
+            targs[i].run.n_threads = 1;
+            targs[i].run.prof_set = 1+i;
+            targs[i].run.checkpoint_interval = 0; // Not supported
+            targs[i].run.run_inf = &targs[i].run_inf;
+            targs[i].rstrats = rstrats;
+            targs[i].n_rstrats = n_rstrats;
+            targs[i].final = &final;
+            targs[i].next_restart = &next_restart;
+            targs[i].next_restart_mutex = &next_restart_mutex;
+            targs[i].initial_lower_bound = initial_lower_bound;
+            // The verbose output of each restart would be interleaved, just report when they finish
+            targs[i].run.verbose = 0;
+            targs[i].verbose = run->verbose;
+        }
+        for(int i=0;i<n_workers;i++){
+            int rc = pthread_create(&threads[i],NULL,restart_thread_execution,&targs[i]);
+            if(rc){
+                fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
+                exit(1);
+            }
+        }
+        // Join threads and merge their counters
+        for(int i=0;i<n_workers;i++){
+            pthread_join(threads[i],NULL);
+            run->run_inf->total_n_iterations       += targs[i].run_inf.total_n_iterations;
+            run->run_inf->n_local_searches         += targs[i].run_inf.n_local_searches;
+            run->run_inf->n_local_search_movements += targs[i].run_inf.n_local_search_movements;
+            run->run_inf->local_search_seconds     += targs[i].run_inf.local_search_seconds;
+            run->run_inf->path_relinking_seconds   += targs[i].run_inf.path_relinking_seconds;
+            run->run_inf->n_bnb_pruned             += targs[i].run_inf.n_bnb_pruned;
+            run->run_inf->time_limit_reached       |= targs[i].run_inf.time_limit_reached;
+            if(targs[i].run_inf.firstr_n_iterations > run->run_inf->firstr_n_iterations){
+                run->run_inf->firstr_n_iterations = targs[i].run_inf.firstr_n_iterations;
+            }
+        }
+        pthread_mutex_destroy(&next_restart_mutex);
+        free(targs);
+        free(threads);
+    }else{
+        // Resume the search from the checkpoint, if requested
+        int first_r = 0;
+        checkpoint *resume = NULL;
+        if(run->resume){
+            resume = checkpoint_load(run->checkpoint_fname,run,rstrats,n_rstrats);
+            if(resume){
+                for(int i=0;i<final.n_sols;i++) solution_free(final.sols[i]);
+                for(int i=0;i<resume->n_final;i++) final.sols[i] = resume->final[i];
+                final.n_sols = resume->n_final;
+                free(resume->final);
+                first_r = resume->restart;
+                if(run->verbose) printf("\nResuming from checkpoint \"%s\" on restart %d.\n",run->checkpoint_fname,first_r+1);
+                if(!resume->in_restart){
+                    checkpoint_free(resume);
+                    resume = NULL;
+                }
+            }else{
+                if(run->verbose) printf("\nNo checkpoint \"%s\" to resume, starting from scratch.\n",run->checkpoint_fname);
+            }
+        }
+        final.last_checkpoint = rundata_elapsed(run);
+        for(int r=first_r;r<run->n_restarts;r++){
+            if(r>first_r && rundata_time_is_up(run)){
+                if(run->verbose) printf("\nTime limit reached, skipping the remaining restarts.\n");
+                run->run_inf->time_limit_reached = 1;
+                break;
+            }
+            // A resumed restart keeps the lower bound of its checkpoint
+            if(run->parallel_restarts && resume==NULL) run->bnb_lower_bound = initial_lower_bound;
+            construction_restart(run,rstrats,n_rstrats,&final,r,resume);
+            if(resume){
+                checkpoint_free(resume);
+                resume = NULL;
+            }
+            construction_checkpoint(run,rstrats,n_rstrats,&final,r+1,0,0,NULL,NULL,0,NULL);
+        }
+    }
+    pthread_mutex_destroy(&final.mutex);
+
+    // With -p, the lower bound reported is the one of all the restarts
+    if(run->parallel_restarts){
+        run->bnb_lower_bound = initial_lower_bound;
+        if(final.n_sols>0 && final.sols[0]->value > run->bnb_lower_bound) run->bnb_lower_bound = final.sols[0]->value;
+    }
+
     // Retrieve the final solutions:
-    *out_n_sols = solmem.n_final;
+    *out_n_sols = final.n_sols;
 
     #ifdef DEBUG
         // Check final solutions integrity
-        for(int i=0;i<solmem.n_final;i++){
-            solution *sol = solmem.final[i];
-            assert(solution_check_integrity(prob,sol));
+        for(int i=0;i<final.n_sols;i++){
+            solution *sol = final.sols[i];
+            assert(solution_check_integrity(run->prob,sol));
         }
     #endif
 
-    return solmem.final;
+    return final.sols;
 }
@@ -0,0 +1,177 @@
+#include "dualbound.h"
+
+// Erlenkotter's dual ascent for the uncapacitated facility location problem with facility costs increased by
+// lambda, starting from v[j] = min_i c_ij. order has, for each client, the facilities sorted by distance.
+// The unassigned cost (row -1, finite when the preprocessing fixes facilities) is a facility that is always open
+// with no cost, so v[j] can't exceed it.
+// Retrieves the lower bound for the cost, sum(v).
+double dual_ascent(const problem *prob, const int *order, double lambda, double *v, double *slack, int *level){
+    int n = prob->n_clis;
+    int m = prob->n_facs;
+    for(int i=0;i<m;i++) slack[i] = prob->facility_cost[i] + lambda;
+    for(int j=0;j<n;j++){
+        const int *ord = &order[j*m];
+        v[j] = problem_assig_cost(prob,ord[0],j);
+        if(problem_assig_cost(prob,-1,j)<v[j]) v[j] = problem_assig_cost(prob,-1,j);
+        // level[j] is the number of facilities with c_ij <= v[j]
+        level[j] = 0;
+        while(level[j]<m && problem_assig_cost(prob,ord[level[j]],j)<=v[j]) level[j]++;
+    }
+    // Increase each v[j] up to the next distance level, while the slacks of the facilities allow it
+    int changed = 1;
+    while(changed){
+        changed = 0;
+        for(int j=0;j<n;j++){
+            const int *ord = &order[j*m];
+            double next = level[j]<m? problem_assig_cost(prob,ord[level[j]],j) : INFINITY;
+            if(problem_assig_cost(prob,-1,j)<next) next = problem_assig_cost(prob,-1,j);
+            double delta = next - v[j];
+            for(int t=0;t<level[j];t++){
+                if(slack[ord[t]]<delta) delta = slack[ord[t]];
+            }
+            if(!(delta>0) || isinf(delta)) continue;
+            v[j] += delta;
+            for(int t=0;t<level[j];t++) slack[ord[t]] -= delta;
+            while(level[j]<m && problem_assig_cost(prob,ord[level[j]],j)<=v[j]) level[j]++;
+            changed = 1;
+        }
+    }
+    double bound = 0;
+    for(int j=0;j<n;j++) bound += v[j];
+    return bound;
+}
+
+// Sorts the facility indexes by the distance to a given client
+typedef struct {
+    int fac;
+    double cost;
+} faccost;
+
+int faccost_cmp(const void *a, const void *b){
+    const faccost *aa = (const faccost *) a;
+    const faccost *bb = (const faccost *) b;
+    if(aa->cost<bb->cost) return -1;
+    if(aa->cost>bb->cost) return +1;
+    return aa->fac - bb->fac;
+}
+
+dualbound *dualbound_init(const problem *prob, int verbose){
+    int n = prob->n_clis;
+    int m = prob->n_facs;
+    if(verbose) printf("\nComputing dual bounds.\n");
+    dualbound *db = safe_malloc(sizeof(dualbound));
+    db->n_duals = 0;
+    db->v = safe_malloc(sizeof(double *)*2);
+    db->lambda = safe_malloc(sizeof(double)*2);
+    db->size_max = prob->size_restriction_maximum;
+    db->root_bound = INFINITY;
+    if(m==0){
+        db->root_bound = -INFINITY;
+        return db;
+    }
+    // Facilities sorted by distance for each client
+    int *order = safe_malloc(sizeof(int)*n*m);
+    faccost *fcs = safe_malloc(sizeof(faccost)*m);
+    // | The total distance from the nearest to the furthest facility, bounds the size multiplier
+    double max_lambda = 0;
+    for(int j=0;j<n;j++){
+        for(int i=0;i<m;i++){
+            fcs[i].fac = i;
+            fcs[i].cost = problem_assig_cost(prob,i,j);
+        }
+        qsort(fcs,m,sizeof(faccost),faccost_cmp);
+        for(int i=0;i<m;i++) order[j*m+i] = fcs[i].fac;
+        max_lambda += fcs[m-1].cost - fcs[0].cost;
+    }
+    free(fcs);
+    double *slack = safe_malloc(sizeof(double)*m);
+    int *level = safe_malloc(sizeof(int)*n);
+    // Dual for the problem without size restriction
+    db->v[0] = safe_malloc(sizeof(double)*n);
+    db->lambda[0] = 0;
+    double bound = dual_ascent(prob,order,0,db->v[0],slack,level);
+    db->n_duals = 1;
+    db->root_bound = -bound;
+    // Lagrangian multiplier for the maximum size: the cost is at least dual_ascent(lambda) - lambda*size_max
+    if(db->size_max>=0 && max_lambda>0){
+        double *v = safe_malloc(sizeof(double)*n);
+        double best_lambda = 0;
+        double best_bound = bound;
+        // Search on a geometric grid
+        for(int k=0;k<=30;k++){
+            double lambda = max_lambda*pow(2,-k);
+            double lbound = dual_ascent(prob,order,lambda,v,slack,level) - lambda*db->size_max;
+            if(lbound>best_bound){
+                best_bound = lbound;
+                best_lambda = lambda;
+            }
+        }
+        // Refine with a golden section search around the best multiplier
+        if(best_lambda>0){
+            const double phi = 0.6180339887498949;
+            double lo = best_lambda/2;
+            double hi = best_lambda*2<max_lambda? best_lambda*2 : max_lambda;
+            for(int it=0;it<25;it++){
+                double a = hi - phi*(hi-lo);
+                double b = lo + phi*(hi-lo);
+                double fa = dual_ascent(prob,order,a,v,slack,level) - a*db->size_max;
+                double fb = dual_ascent(prob,order,b,v,slack,level) - b*db->size_max;
+                if(fa>best_bound){
+                    best_bound = fa;
+                    best_lambda = a;
+                }
+                if(fb>best_bound){
+                    best_bound = fb;
+                    best_lambda = b;
+                }
+                if(fa>fb) hi = b;
+                else lo = a;
+            }
+            // Keep the dual of the best multiplier
+            dual_ascent(prob,order,best_lambda,v,slack,level);
+            db->v[1] = v;
+            db->lambda[1] = best_lambda;
+            db->n_duals = 2;
+            if(-best_bound<db->root_bound) db->root_bound = -best_bound;
+        }else{
+            free(v);
+        }
+    }
+    free(level);
+    free(slack);
+    free(order);
+    if(verbose) printf("Upper bound for the value: %lf\n",db->root_bound);
+    return db;
+}
+
+void dualbound_free(dualbound *db){
+    for(int k=0;k<db->n_duals;k++) free(db->v[k]);
+    free(db->v);
+    free(db->lambda);
+    free(db);
+}
+
+double dualbound_solution(const dualbound *db, const problem *prob, const solution *sol, int *assigns_buffer){
+    if(db->n_duals==0) return db->root_bound;
+    const int *assigns = sol->assigns;
+    if(assigns==NULL){
+        solution_get_assigns(prob,sol,assigns_buffer);
+        assigns = assigns_buffer;
+    }
+    double facs_cost = 0;
+    for(int k=0;k<sol->n_facs;k++) facs_cost += prob->facility_cost[sol->facs[k]];
+    // The facilities of the solution are open with no cost, so each v[j] can be at most the distance to
+    // the nearest of them and the dual solution remains feasible
+    double best = INFINITY;
+    for(int d=0;d<db->n_duals;d++){
+        const double *v = db->v[d];
+        double cost = facs_cost;
+        for(int j=0;j<prob->n_clis;j++){
+            double c = problem_assig_cost(prob,assigns[j],j);
+            cost += c<v[j]? c : v[j];
+        }
+        if(db->lambda[d]>0) cost += db->lambda[d]*(sol->n_facs - db->size_max);
+        if(-cost<best) best = -cost;
+    }
+    return best;
+}
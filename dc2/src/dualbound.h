@@ -0,0 +1,34 @@
+#ifndef DC_DUALBOUND_H
+#define DC_DUALBOUND_H
+
+#include "utils.h"
+#include "problem.h"
+#include "solution.h"
+
+// Upper bounds for the value of the solutions (lower bounds for their cost), from dual solutions of the problem.
+// The dual of the uncapacitated facility location problem is found with Erlenkotter's dual ascent, and, when
+// the size of the solutions is restricted, a Lagrangian multiplier for the size restriction is also searched.
+// (dualbound is declared on rundata.h)
+struct dualbound {
+    // | Number of dual solutions
+    int n_duals;
+    // | Value of the dual variable of each client, for each dual solution
+    double **v;
+    // | Lagrangian multiplier of the size restriction of each dual solution (0 if it is not used)
+    double *lambda;
+    // | Maximum size of the solutions, -1 if it is not restricted
+    int size_max;
+    // | Upper bound for the value of any solution
+    double root_bound;
+};
+
+// Computes the dual solutions for the problem
+dualbound *dualbound_init(const problem *prob, int verbose);
+
+void dualbound_free(dualbound *db);
+
+// Upper bound for the value of any solution that contains the facilities of sol, in O(n_clis) time.
+// assigns_buffer is an array of size prob->n_clis, only used if sol is a delta solution.
+double dualbound_solution(const dualbound *db, const problem *prob, const solution *sol, int *assigns_buffer);
+
+#endif
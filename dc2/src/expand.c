@@ -1,4 +1,6 @@
 #include "expand.h"
+#include "bnb.h"
+#include "profiler.h"
 
 //#############################################################
 // FUTURESOLS
@@ -7,8 +9,9 @@
 // Possible future solution that results from another one.
 typedef struct {
     solution *origin;
+    int origin_id;
     int newf;
-    uint hash;
+    uint64_t hash;
     int n_facs;
     int facs[0]; // Flexible array member.
 } futuresol;
@@ -29,19 +32,19 @@ int futuresol_cmp(const void *a, const void *b){
 }
 
 // Inits a futuresol from a current sol and a new facility
-int futuresol_init_from(futuresol *fsol, solution *sol, int newf){
+int futuresol_init_from(futuresol *fsol, solution *sol, int sol_id, int newf){
     assert(sol!=NULL);
     fsol->origin = sol;
+    fsol->origin_id = sol_id;
     fsol->newf = newf;
     fsol->n_facs = sol->n_facs;
-    // Copy facilitites, check if f already exists, init hash.
-    fsol -> hash = hash_int(newf);
+    // Copy facilitites, check if f already exists.
     for(int k=0;k<sol->n_facs;k++){
         if(sol->facs[k]==newf) return 0; // If the solution candidate is not new // TODO: make faster when sols->nfacs is near n
         fsol->facs[k] = sol->facs[k];
-        // Include solution on the hash
-        fsol->hash = fsol->hash ^ hash_int(fsol->facs[k]);
     }
+    // The hash of the child is the one of the parent with the new facility
+    fsol->hash = sol->hash ^ zobrist_key(newf);
     // Add the new facility to the inner array
     add_to_sorted(fsol->facs,&fsol->n_facs,newf);
     return 1;
@@ -58,8 +61,80 @@ typedef struct {
     void *futuresols;
     size_t fsol_size;
     solution **out_sols;
+    int n_pruned;
+    int generation;
+    // Nearest and 2nd nearest facility of each client on each parent (only for BETTER_THAN_SUBSETS)
+    const int *parents_phis;
 } expand_thread_args;
 
+typedef struct {
+    int thread_id;
+    const rundata *run;
+    solution **sols;
+    int n_sols;
+    int *parents_phis;
+    int generation;
+} parent_phis_thread_args;
+
+void *parent_phis_thread_execution(void *arg){
+    parent_phis_thread_args *args = (parent_phis_thread_args *) arg;
+    const problem *prob = args->run->prob;
+    uint64_t prof_start = profiler_now(args->run->prof);
+    for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
+        int *phi1 = &args->parents_phis[(size_t)2*prob->n_clis*r];
+        int *phi2 = &phi1[prob->n_clis];
+        solution_compute_phi1_and_phi2(prob,args->sols[r],phi1,phi2);
+    }
+    profiler_span(args->run->prof,PHASE_FILTER,prof_start,args->run->prof_set,args->thread_id+1,args->generation,NULL);
+    return NULL;
+}
+
+// Finds the profit of removing the best facility from the child of a parent with newf, using the nearest and
+// 2nd nearest facilities of each client on the parent, so that the child's assignments aren't needed.
+// The child's phi1 and phi2 are derived in the same pass that computes the loss of removing each facility,
+// as solution_findout does with f_ins=-1. v must be of size n_facs, filled with -INFINITY.
+double child_removal_profit(const problem *prob, const solution *child, int newf,
+        const int *par_phi1, const int *par_phi2, double *v){
+    for(int k=0;k<child->n_facs;k++){
+        v[child->facs[k]] = -prob->facility_cost[child->facs[k]];
+    }
+    double w = 0;
+    for(int u=0;u<prob->n_clis;u++){
+        int phi1u = par_phi1[u];
+        int phi2u = par_phi2[u];
+        double newf_value = problem_assig_value(prob,newf,u);
+        if(newf_value>problem_assig_value(prob,phi1u,u)){
+            // newf becomes the nearest facility
+            phi2u = phi1u;
+            phi1u = newf;
+        }else if(newf_value>problem_assig_value(prob,phi2u,u)){
+            // newf becomes the 2nd nearest facility
+            phi2u = newf;
+        }
+        double unassig_value = problem_assig_value(prob,-1,u);
+        double assig_phi1u_value = problem_assig_value(prob,phi1u,u);
+        double delta = unassig_value - assig_phi1u_value;
+        if(delta>=0){
+            w += delta;
+        }else{
+            if(phi1u==-1) continue;
+            double assig_phi2u_value = problem_assig_value(prob,phi2u,u);
+            v[phi1u] += assig_phi1u_value - fmax(unassig_value,assig_phi2u_value);
+        }
+    }
+    // Find the one to be removed with less loss, and reset v
+    int f_rem = -1;
+    for(int k=0;k<child->n_facs;k++){
+        int f = child->facs[k];
+        if(f_rem==-1 || v[f]<v[f_rem]) f_rem = f;
+    }
+    double profit = w - (f_rem==-1? 0 : v[f_rem]);
+    for(int k=0;k<child->n_facs;k++){
+        v[child->facs[k]] = -INFINITY;
+    }
+    return profit;
+}
+
 // Check if a solution passes the value of which it would be filtered.
 // Equal valued solutions are not filtered if the size restriction has not yet ben reached
 // Or if the other value is -INFINITY.
@@ -75,17 +150,32 @@ int is_filtered(const problem *prob, const solution *sol, double other){
 void *expand_thread_execution(void *arg){
     expand_thread_args *args = (expand_thread_args *) arg;
     const problem *prob = args->run->prob;
+    profiler *prof = args->run->prof;
+    uint64_t prof_start = profiler_now(prof);
+    // Time spent on filtering, too short to record each one as a span
+    uint64_t filter_ns = 0;
 
     // Auxiliary arrays that could be useful
-    int *phi2 = NULL;
     double *v = NULL;
+    int *delta_buffer = NULL;
+    int *bnb_buffer = NULL;
 
     for(int r=args->thread_id;r<args->n_fsols;r+=args->run->n_threads){
         // Generate a new solution from the fsol, and then check if it passes filtering.
         futuresol *fsol = (futuresol *)(args->futuresols+args->fsol_size*r);
-        solution *new_sol = solution_copy(prob,fsol->origin);
-        solution_add(prob,new_sol,fsol->newf,NULL);
+        solution *new_sol;
+        if(args->run->delta_solutions){
+            if(delta_buffer==NULL) delta_buffer = safe_malloc(sizeof(int)*2*prob->n_clis);
+            new_sol = solution_child(prob,fsol->origin,fsol->newf,delta_buffer);
+        }else{
+            new_sol = solution_copy(prob,fsol->origin);
+            solution_add(prob,new_sol,fsol->newf,NULL);
+        }
+        #ifdef DEBUG
+            assert(new_sol->hash==fsol->hash);
+        #endif
         int filtered = 0;
+        uint64_t filter_start = profiler_now(prof);
         // Must be better than any other subset (minus 1 facility)
         if(args->run->filter >= BETTER_THAN_SUBSETS){
             // Initialize useful arrays if they aren't already
@@ -93,15 +183,25 @@ void *expand_thread_execution(void *arg){
                 v = safe_malloc(sizeof(double)*prob->n_facs);
                 for(int i=0;i<prob->n_facs;i++) v[i] = -INFINITY;
             }
-            if(phi2==NULL) phi2 = safe_malloc(sizeof(int)*prob->n_clis);
-            // Find second nearest facility for each client
-            for(int i=0;i<prob->n_clis;i++){
-                phi2[i] = solution_client_2nd_nearest(prob,new_sol,i);
-            }
             // Check if there's profit after picking the best facility for removal
-            int f_rem;
-            double delta_profit,delta_profit_worem;
-            solution_findout(prob,new_sol,-1,v,phi2,NULL,&f_rem,&delta_profit,&delta_profit_worem);
+            const int *par_phi1 = &args->parents_phis[(size_t)2*prob->n_clis*fsol->origin_id];
+            const int *par_phi2 = &par_phi1[prob->n_clis];
+            double delta_profit = child_removal_profit(prob,new_sol,fsol->newf,par_phi1,par_phi2,v);
+            #ifdef DEBUG
+            {
+                // Compare with the profit computed from the child's own assignments
+                solution *check = solution_copy(prob,new_sol);
+                solution_make_writable(prob,&check);
+                int *phi2 = safe_malloc(sizeof(int)*prob->n_clis);
+                for(int i=0;i<prob->n_clis;i++) phi2[i] = solution_client_2nd_nearest(prob,check,i);
+                int f_rem;
+                double delta_profit2,delta_profit_worem;
+                solution_findout(prob,check,-1,v,phi2,NULL,&f_rem,&delta_profit2,&delta_profit_worem);
+                assert(delta_profit==delta_profit2 || fabs(delta_profit-delta_profit2)<=1e-6*fmax(1.0,fabs(delta_profit)));
+                free(phi2);
+                solution_free(check);
+            }
+            #endif
             filtered = is_filtered(prob,new_sol,new_sol->value+delta_profit);
         }
         // Filters that use fsol->origin
@@ -114,6 +214,15 @@ void *expand_thread_execution(void *arg){
         else if(args->run->filter == BETTER_THAN_EMPTY){
             filtered = is_filtered(prob,new_sol,-INFINITY);
         }
+        // Prune the solution if it can't lead to a better one than the best found so far
+        if(!filtered && args->run->branch_and_bound && args->run->bnb_lower_bound>-INFINITY){
+            if(bnb_buffer==NULL) bnb_buffer = safe_malloc(sizeof(int)*prob->n_clis);
+            if(bnb_upper_bound(args->run,new_sol,bnb_buffer) < args->run->bnb_lower_bound){
+                filtered = 1;
+                args->n_pruned += 1;
+            }
+        }
+        filter_ns += profiler_now(prof)-filter_start;
         // Delete the solution
         if(filtered){
             solution_free(new_sol);
@@ -124,8 +233,11 @@ void *expand_thread_execution(void *arg){
     }
     // Free auxilary arrays if they were allocated
     if(v!=NULL) free(v);
-    if(phi2!=NULL) free(phi2);
+    if(delta_buffer!=NULL) free(delta_buffer);
+    if(bnb_buffer!=NULL) free(bnb_buffer);
     //
+    profiler_add(prof,PHASE_FILTER,filter_ns);
+    profiler_span(prof,PHASE_EXPAND,prof_start,args->run->prof_set,args->thread_id+1,args->generation,NULL);
     return NULL;
 }
 
@@ -134,8 +246,9 @@ void *expand_thread_execution(void *arg){
 //#############################################################
 
 solution **new_expand_solutions(const rundata *run,
-        solution **sols, int n_sols, int *out_n_sols, int pool_size){
+        solution **sols, int n_sols, int *out_n_sols, int pool_size, ranxoshi256 *rngen){
     const problem *prob = run->prob;
+    uint64_t prof_start = profiler_begin(run->prof,PHASE_EXPAND);
     // Get the corrent size of the solutions on this expansion:
     int current_size = n_sols>0? sols[0]->n_facs : 0;
     // Compute the size of each futuresol (flexible array member must be added):
@@ -180,19 +293,20 @@ solution **new_expand_solutions(const rundata *run,
             assert(sols[i]->n_facs==current_size); // All solutions are expected to have the same size.
             for(int f=0;f<prob->n_facs;f++){
                 futuresol *fsol = (futuresol *)(futuresols+fsol_size*n_futuresols);
-                n_futuresols += futuresol_init_from(fsol,sols[i],f);
+                n_futuresols += futuresol_init_from(fsol,sols[i],i,f);
             }
         }
     }else{
         // Pick children at random
         shuffler *shuf = shuffler_init(prob->n_facs);
+        shuffler_seed(shuf,ranxoshi256Next(rngen),0);
         for(int i=0;i<n_sols;i++){
             shuffler_reshuffle(shuf);
             int n_childs = 0;
             while(n_childs<branching){
                 int f = (int) shuffler_next(shuf);
                 futuresol *fsol = (futuresol *)(futuresols+fsol_size*n_futuresols);
-                int new_found = futuresol_init_from(fsol,sols[i],f);
+                int new_found = futuresol_init_from(fsol,sols[i],i,f);
                 n_childs     += new_found;
                 n_futuresols += new_found;
             }
@@ -231,6 +345,34 @@ solution **new_expand_solutions(const rundata *run,
         futuresols = safe_realloc(futuresols,fsol_size*n_futuresols);
     }
 
+    // Nearest and 2nd nearest facilities of the clients on each parent, to derive the ones of their children
+    int *parents_phis = NULL;
+    if(run->filter>=BETTER_THAN_SUBSETS && n_sols>0){
+        parents_phis = safe_malloc(sizeof(int)*2*(size_t)prob->n_clis*n_sols);
+        parent_phis_thread_args *targs = safe_malloc(sizeof(parent_phis_thread_args)*run->n_threads);
+        for(int i=0;i<run->n_threads;i++){
+            targs[i].thread_id = i;
+            targs[i].run = run;
+            targs[i].sols = sols;
+            targs[i].n_sols = n_sols;
+            targs[i].parents_phis = parents_phis;
+            targs[i].generation = current_size+1;
+        }
+        pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
+        for(int i=0;i<run->n_threads;i++){
+            int rc = pthread_create(&threads[i],NULL,parent_phis_thread_execution,&targs[i]);
+            if(rc){
+                fprintf(stderr,"Error %d on thread creation\n",rc);
+                exit(1);
+            }
+        }
+        for(int i=0;i<run->n_threads;i++){
+            pthread_join(threads[i],NULL);
+        }
+        free(threads);
+        free(targs);
+    }
+
     solution **out_sols = safe_malloc(sizeof(solution*)*n_futuresols);
     { // Create new solutions [in parallel]
         expand_thread_args *targs = safe_malloc(sizeof(expand_thread_args)*run->n_threads);
@@ -241,6 +383,9 @@ solution **new_expand_solutions(const rundata *run,
             targs[i].futuresols = futuresols;
             targs[i].fsol_size = fsol_size;
             targs[i].out_sols = out_sols;
+            targs[i].n_pruned = 0;
+            targs[i].parents_phis = parents_phis;
+            targs[i].generation = current_size+1;
         }
         // Generate threads in order to expand the solutions
         pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
@@ -254,6 +399,7 @@ solution **new_expand_solutions(const rundata *run,
         // Join threads
         for(int i=0;i<run->n_threads;i++){
             pthread_join(threads[i],NULL);
+            run->run_inf->n_bnb_pruned += targs[i].n_pruned;
         }
         //
         free(threads);
@@ -277,7 +423,8 @@ solution **new_expand_solutions(const rundata *run,
         *out_n_sols = n_sols;
     }
 
-
+    if(parents_phis!=NULL) free(parents_phis);
     free(futuresols);
+    profiler_span(run->prof,PHASE_EXPAND,prof_start,run->prof_set,0,current_size+1,NULL);
     return out_sols;
 }
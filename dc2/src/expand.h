@@ -5,7 +5,8 @@
 #include "solution.h"
 #include "shuffle.h"
 
+// Creates the children of the given solutions, the random ones (with a branching factor) are drawn from rngen.
 solution **new_expand_solutions(const rundata *run,
-        solution **sols, int n_sols, int *out_n_sols, int pool_size);
+        solution **sols, int n_sols, int *out_n_sols, int pool_size, ranxoshi256 *rngen);
 
 #endif
@@ -0,0 +1,381 @@
+#include "libdc2.h"
+#include "problem.h"
+#include "construction.h"
+#include "lsmemo.h"
+#include "preprocess.h"
+#include "localsearch.h"
+#include "shuffle.h"
+
+#include <time.h>
+#include <sys/time.h>
+
+// NOTE: the allocation functions of the solver abort if errno is set, so every public function clears the errno
+// that the host may have left, and so do the callbacks after calling the host.
+
+void dc2_config_default(dc2_config *cfg){
+    errno = 0;
+    memset(cfg,0,sizeof(dc2_config));
+    cfg->strategies = NULL;
+    cfg->n_strategies = 0;
+    cfg->random_seed = 42;
+    cfg->restarts = 1;
+    cfg->target_sols = DEFAULT_TARGET_SOLS;
+    cfg->n_threads = DEFAULT_THREADS;
+    cfg->parallel_restarts = DEFAULT_PARALLEL_RESTARTS;
+    cfg->time_limit = 0;
+    cfg->time_limit_cpu = 0;
+    cfg->min_size = -1;
+    cfg->max_size = -1;
+    cfg->filter = FILTER_DEFAULT;
+    cfg->branching_factor = DEFAULT_BRANCHING_FACTOR;
+    cfg->branching_correction = DEFAULT_BRANCHING_CORRECTION;
+    cfg->local_search = DEFAULT_LOCAL_SEARCH;
+    cfg->local_search_pr = -1;
+    cfg->local_search_all = !DEFAULT_SELECT_ONLY_TERMINAL;
+    cfg->local_search_after_select = !DEFAULT_LOCAL_SEARCH_BEFORE_SELECT;
+    cfg->local_search_fixed_size = !DEFAULT_LOCAL_SEARCH_SIZE_CHANGE_MOVEMENTS_ENABLED;
+    cfg->path_relinking = DEFAULT_PATH_RELINKING;
+    cfg->pr_partners = 0;
+    cfg->pr_truncate = 1;
+    cfg->pr_round_robin = 0;
+    cfg->ls_memo_size = 0;
+    cfg->delta_solutions = 0;
+    cfg->branch_and_bound = BRANCH_AND_BOUND_DEFAULT;
+    cfg->preprocess = 0;
+    cfg->merge_clients = 1;
+    cfg->verbose = 0;
+}
+
+const char *dc2_error_string(int code){
+    errno = 0;
+    switch(code){
+        case DC2_OK:              return "no error";
+        case DC2_INVALID_PROBLEM: return "invalid problem";
+        case DC2_INVALID_CONFIG:  return "invalid configuration";
+    }
+    return "unknown error";
+}
+
+static int problem_is_valid(const dc2_problem *prob){
+    return prob->n_facs>0 && prob->n_clis>0 && prob->facility_cost!=NULL && prob->costs!=NULL;
+}
+
+static int config_is_valid(const dc2_config *cfg){
+    if(cfg->n_strategies<0 || (cfg->n_strategies>0 && cfg->strategies==NULL)) return 0;
+    if(cfg->restarts<1 || cfg->target_sols<1 || cfg->n_threads<1) return 0;
+    if(cfg->time_limit<0) return 0;
+    if(cfg->filter<0 || cfg->filter>MAX_FILTER) return 0;
+    if(cfg->branching_factor<-1) return 0;
+    if(cfg->local_search<NO_LOCAL_SEARCH || cfg->local_search>SWAP_RESENDE_WERNECK) return 0;
+    if(cfg->local_search_pr<-1 || cfg->local_search_pr>SWAP_RESENDE_WERNECK) return 0;
+    if(cfg->path_relinking<NO_PATH_RELINKING || cfg->path_relinking>PATH_RELINKING_UNTIL_NO_BETTER) return 0;
+    // Like dc, the path relinking local search can't be given without path relinking
+    if(cfg->path_relinking==NO_PATH_RELINKING && cfg->local_search_pr!=-1) return 0;
+    if(cfg->pr_partners<0 || cfg->pr_truncate<=0 || cfg->pr_truncate>1) return 0;
+    if(cfg->ls_memo_size<0) return 0;
+    return 1;
+}
+
+// Fills a dc2_solution from a solution of the original problem
+static void fill_solution(const problem *prob, const solution *sol, dc2_solution *out){
+    out->value = sol->value;
+    out->n_facs = sol->n_facs;
+    out->facs = safe_malloc(sizeof(int)*(sol->n_facs+1));
+    memcpy(out->facs,sol->facs,sizeof(int)*sol->n_facs);
+    out->assigns = safe_malloc(sizeof(int)*prob->n_clis);
+    solution_get_assigns(prob,sol,out->assigns);
+}
+
+void dc2_solution_free(dc2_solution *sol){
+    errno = 0;
+    free(sol->facs);
+    free(sol->assigns);
+}
+
+static void lib_improvement(const rundata *run, const solution *sol, void *data){
+    const dc2_config *cfg = data;
+    if(cfg->on_improvement==NULL) return;
+    // Report the solution of the original problem
+    dc2_solution out;
+    if(run->prepro!=NULL){
+        solution *orig_sol = preprocessing_map_solution(run->prepro,sol);
+        fill_solution(run->prepro->orig,orig_sol,&out);
+        solution_free(orig_sol);
+    }else{
+        fill_solution(run->prob,sol,&out);
+    }
+    cfg->on_improvement(&out,rundata_elapsed(run),cfg->user_data);
+    errno = 0;
+    dc2_solution_free(&out);
+}
+
+static int lib_progress(const rundata *run, int restart, int size, int n_sols, void *data){
+    const dc2_config *cfg = data;
+    if(cfg->on_progress==NULL) return 0;
+    int stop = cfg->on_progress(restart,size,n_sols,rundata_elapsed(run),cfg->user_data);
+    errno = 0;
+    return stop;
+}
+
+int dc2_solve(const dc2_problem *dprob, const dc2_config *cfg, dc2_result *res){
+    errno = 0;
+    memset(res,0,sizeof(dc2_result));
+    if(!problem_is_valid(dprob)) return DC2_INVALID_PROBLEM;
+    if(!config_is_valid(cfg)) return DC2_INVALID_CONFIG;
+
+    // Invalid strategies are a configuration error, instead of exiting like dc
+    char error[REDSTRATEGY_ERROR_LEN];
+    int n_strategies = cfg->n_strategies;
+    redstrategy *strategies = redstrategy_parse_nomenclatures(cfg->strategies,&n_strategies,error);
+    if(strategies==NULL){
+        if(cfg->verbose) printf("Invalid strategies: %s\n",error);
+        return DC2_INVALID_CONFIG;
+    }
+
+    // The problem uses the caller's arrays, which are only read
+    problem *prob = problem_wrap(dprob->n_facs,dprob->n_clis,
+        (double *) dprob->facility_cost,(double *) dprob->costs);
+    prob->size_restriction_minimum = cfg->min_size;
+    prob->size_restriction_maximum = cfg->max_size;
+
+    // Reduce the problem, as dc does
+    preprocessing *prepro = NULL;
+    problem *orig_prob = NULL;
+    if(cfg->preprocess || cfg->merge_clients){
+        prepro = preprocessing_init(prob,cfg->preprocess,cfg->verbose);
+        if(preprocessing_is_trivial(prepro)){
+            preprocessing_free(prepro);
+            prepro = NULL;
+        }else{
+            orig_prob = prob;
+            prob = problem_copy(prepro->prob);
+        }
+    }
+
+    // Precompute the nearly indexes if Resende and Werneck's local search may be used
+    int local_search_pr = cfg->local_search_pr;
+    if(local_search_pr==-1) local_search_pr = cfg->local_search!=NO_LOCAL_SEARCH? cfg->local_search : DEFAULT_LOCAL_SEARCH;
+    int precomp_nearly_indexes = cfg->local_search==SWAP_RESENDE_WERNECK ||
+        (cfg->path_relinking!=NO_PATH_RELINKING && local_search_pr==SWAP_RESENDE_WERNECK);
+
+    rundata *run = rundata_init(prob,strategies,n_strategies,cfg->restarts,precomp_nearly_indexes,cfg->n_threads,cfg->verbose);
+    prob = NULL;
+
+    run->prepro = prepro;
+    run->random_seed = cfg->random_seed;
+    run->target_sols = cfg->target_sols;
+    run->parallel_restarts = cfg->parallel_restarts;
+    run->time_limit = cfg->time_limit;
+    run->time_limit_cpu = cfg->time_limit_cpu;
+    run->filter = cfg->filter;
+    run->branching_factor = cfg->branching_factor;
+    run->branching_correction = cfg->branching_correction;
+    run->local_search = cfg->local_search;
+    run->local_search_pr = local_search_pr;
+    run->select_only_terminal = !cfg->local_search_all;
+    run->local_search_before_select = !cfg->local_search_after_select;
+    run->local_search_rem_movement = !cfg->local_search_fixed_size;
+    run->local_search_add_movement = !cfg->local_search_fixed_size;
+    run->path_relinking = cfg->path_relinking;
+    run->pr_partners = cfg->pr_partners;
+    run->pr_truncate = cfg->pr_truncate;
+    run->pr_round_robin = cfg->pr_round_robin;
+    if(cfg->ls_memo_size>0) run->ls_memo = lsmemo_init(cfg->ls_memo_size);
+    run->delta_solutions = cfg->delta_solutions;
+    run->branch_and_bound = cfg->branch_and_bound;
+
+    runcallbacks callbacks;
+    if(cfg->on_improvement!=NULL || cfg->on_progress!=NULL){
+        callbacks.improvement = cfg->on_improvement!=NULL? lib_improvement : NULL;
+        callbacks.progress = cfg->on_progress!=NULL? lib_progress : NULL;
+        callbacks.data = (void *) cfg;
+        callbacks.stop = 0;
+        run->callbacks = &callbacks;
+    }
+
+    // Start counting time (cpu and elapsed)
+    clock_t start = clock();
+    rundata_start_timer(run);
+
+    if(run->verbose){
+        rundata_print(run,stdout);
+        printf("\n");
+    }
+
+    int final_n_sols;
+    solution **final_sols = new_find_best_solutions(run,strategies,n_strategies,&final_n_sols);
+
+    res->cpu_seconds = (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+    res->elapsed = rundata_elapsed(run);
+    res->stopped = run->run_inf->time_limit_reached;
+    res->n_iterations = run->run_inf->total_n_iterations;
+
+    // Retrieve the solutions of the original problem
+    res->n_clis = dprob->n_clis;
+    res->n_sols = final_n_sols;
+    res->sols = safe_malloc(sizeof(dc2_solution)*(final_n_sols+1));
+    for(int i=0;i<final_n_sols;i++){
+        if(run->prepro!=NULL){
+            solution *orig_sol = preprocessing_map_solution(run->prepro,final_sols[i]);
+            fill_solution(run->prepro->orig,orig_sol,&res->sols[i]);
+            solution_free(orig_sol);
+        }else{
+            fill_solution(run->prob,final_sols[i],&res->sols[i]);
+        }
+        solution_free(final_sols[i]);
+    }
+    free(final_sols);
+
+    // Free memory
+    rundata_free(run);
+    if(orig_prob!=NULL) problem_free(orig_prob);
+    free(strategies);
+
+    return DC2_OK;
+}
+
+void dc2_result_free(dc2_result *res){
+    errno = 0;
+    for(int i=0;i<res->n_sols;i++) dc2_solution_free(&res->sols[i]);
+    free(res->sols);
+    res->sols = NULL;
+    res->n_sols = 0;
+}
+
+// ============================================================================
+// ======== SESSIONS
+// ============================================================================
+
+struct dc2_session {
+    // | The problem is the one of the rundata, which is modified on each change
+    rundata *run;
+    // | Current solution, with room for the clients that fit on the problem
+    solution *sol;
+    // | 1st and 2nd nearest facility of the solution to each client
+    int *phi1, *phi2;
+    // | Previous costs of a client that is changed
+    double *old_costs;
+    // | Reused by the local searches (NULL until needed)
+    fastmat *mat;
+    shuffler *shuff;
+};
+
+dc2_session *dc2_session_init(const dc2_problem *dprob, const dc2_config *cfg, const int *facs, int n_facs){
+    errno = 0;
+    if(!problem_is_valid(dprob) || !config_is_valid(cfg) || n_facs<1) return NULL;
+    for(int k=0;k<n_facs;k++){
+        if(facs[k]<0 || facs[k]>=dprob->n_facs) return NULL;
+    }
+    dc2_session *ses = safe_malloc(sizeof(dc2_session));
+
+    // The session has its own copy of the problem, as it changes
+    problem *wrap = problem_wrap(dprob->n_facs,dprob->n_clis,(double *) dprob->facility_cost,(double *) dprob->costs);
+    problem *prob = problem_copy(wrap);
+    problem_free(wrap);
+
+    ses->run = rundata_init(prob,NULL,0,1,cfg->local_search==SWAP_RESENDE_WERNECK,cfg->n_threads,cfg->verbose);
+    ses->run->random_seed = cfg->random_seed;
+    ses->run->local_search = cfg->local_search;
+    ses->run->local_search_rem_movement = !cfg->local_search_fixed_size;
+    ses->run->local_search_add_movement = !cfg->local_search_fixed_size;
+
+    ses->sol = solution_empty(prob);
+    for(int k=0;k<n_facs;k++) solution_add(prob,ses->sol,facs[k],NULL);
+    ses->phi1 = safe_malloc(sizeof(int)*prob->clis_capacity);
+    ses->phi2 = safe_malloc(sizeof(int)*prob->clis_capacity);
+    solution_compute_phi1_and_phi2(prob,ses->sol,ses->phi1,ses->phi2);
+    ses->old_costs = safe_malloc(sizeof(double)*prob->n_facs);
+    ses->mat = NULL;
+    ses->shuff = NULL;
+    return ses;
+}
+
+int dc2_session_set_facility_cost(dc2_session *ses, int f, double cost){
+    errno = 0;
+    problem *prob = ses->run->prob;
+    if(f<0 || f>=prob->n_facs) return DC2_INVALID_PROBLEM;
+    double old_cost = prob->facility_cost[f];
+    prob->facility_cost[f] = cost;
+    solution_update_facility_cost(prob,ses->sol,f,old_cost);
+    return DC2_OK;
+}
+
+int dc2_session_set_client_costs(dc2_session *ses, int c, const double *costs){
+    errno = 0;
+    problem *prob = ses->run->prob;
+    if(c<0 || c>=prob->n_clis) return DC2_INVALID_PROBLEM;
+    for(int i=0;i<prob->n_facs;i++) ses->old_costs[i] = prob->distance_cost[i][c];
+    problem_set_client_costs(prob,c,costs);
+    runprecomp_update_client(ses->run->precomp,prob,c,ses->old_costs);
+    solution_update_client(prob,ses->sol,c,ses->old_costs,ses->phi1,ses->phi2);
+    return DC2_OK;
+}
+
+int dc2_session_add_client(dc2_session *ses, const double *costs){
+    errno = 0;
+    problem *prob = ses->run->prob;
+    int c = problem_add_client(prob,costs);
+    // Keep room for all the clients that fit on the problem (the local search may replace the solution)
+    ses->sol->assigns = safe_realloc(ses->sol->assigns,sizeof(int)*prob->clis_capacity);
+    ses->phi1 = safe_realloc(ses->phi1,sizeof(int)*prob->clis_capacity);
+    ses->phi2 = safe_realloc(ses->phi2,sizeof(int)*prob->clis_capacity);
+    runprecomp_update_client(ses->run->precomp,prob,c,NULL);
+    solution_update_client(prob,ses->sol,c,NULL,ses->phi1,ses->phi2);
+    return c;
+}
+
+int dc2_session_remove_client(dc2_session *ses, int c){
+    errno = 0;
+    problem *prob = ses->run->prob;
+    if(c<0 || c>=prob->n_clis || prob->n_clis==1) return DC2_INVALID_PROBLEM;
+    runprecomp_remove_client(ses->run->precomp,prob,c);
+    solution_remove_client(prob,ses->sol,c,ses->phi1,ses->phi2);
+    problem_remove_client(prob,c);
+    return DC2_OK;
+}
+
+int dc2_session_local_search(dc2_session *ses){
+    errno = 0;
+    rundata *run = ses->run;
+    const problem *prob = run->prob;
+    int n_moves = 0;
+    if(run->local_search==SWAP_RESENDE_WERNECK){
+        // Starts from the nearest facilities that were kept up to date
+        if(ses->mat==NULL) ses->mat = fastmat_init(prob->n_facs,prob->n_facs);
+        n_moves = solution_resendewerneck_hill_climbing_phis(run,&ses->sol,ses->mat,ses->phi1,ses->phi2);
+    }else if(run->local_search!=NO_LOCAL_SEARCH){
+        shuffler *shuff = NULL;
+        if(run->local_search==SWAP_FIRST_IMPROVEMENT){
+            if(ses->shuff==NULL) ses->shuff = shuffler_init(prob->n_facs);
+            shuffler_seed(ses->shuff,run->random_seed,ses->sol->hash);
+            shuff = ses->shuff;
+        }
+        n_moves = solution_whitaker_hill_climbing(run,&ses->sol,NULL,shuff);
+        if(n_moves>0) solution_compute_phi1_and_phi2(prob,ses->sol,ses->phi1,ses->phi2);
+    }
+    // The solution may have been replaced
+    ses->sol->assigns = safe_realloc(ses->sol->assigns,sizeof(int)*prob->clis_capacity);
+    return n_moves;
+}
+
+int dc2_session_n_clis(const dc2_session *ses){
+    errno = 0;
+    return ses->run->prob->n_clis;
+}
+
+void dc2_session_get_solution(const dc2_session *ses, dc2_solution *sol){
+    errno = 0;
+    fill_solution(ses->run->prob,ses->sol,sol);
+}
+
+void dc2_session_free(dc2_session *ses){
+    errno = 0;
+    solution_free(ses->sol);
+    free(ses->phi1);
+    free(ses->phi2);
+    free(ses->old_costs);
+    if(ses->mat!=NULL) fastmat_free(ses->mat);
+    if(ses->shuff!=NULL) shuffler_free(ses->shuff);
+    rundata_free(ses->run);
+    free(ses);
+}
@@ -0,0 +1,187 @@
+#ifndef LIBDC2_H
+#define LIBDC2_H
+
+// libdc2: the solver of dc as a library, for programs that already have the problem in memory.
+// The costs are read from arrays owned by the caller, without copying them, and the solutions are retrieved as arrays.
+// Different problems can be solved at the same time from different threads.
+// NOTE: like dc, the solver prints an error and exits if the memory runs out.
+
+#ifdef __GNUC__
+#define DC2_API __attribute__((visibility("default")))
+#else
+#define DC2_API
+#endif
+
+// Local searches, as -l, -w, -L and -W
+#define DC2_NO_LOCAL_SEARCH        0
+#define DC2_SWAP_BEST_IMPROVEMENT  1
+#define DC2_SWAP_FIRST_IMPROVEMENT 2
+#define DC2_SWAP_RESENDE_WERNECK   3
+
+// Path relinking, as -P and -M
+#define DC2_NO_PATH_RELINKING              0
+#define DC2_PATH_RELINKING_1_ITER          1
+#define DC2_PATH_RELINKING_UNTIL_NO_BETTER 2
+
+// Error codes retrieved by dc2_solve and the session functions
+#define DC2_OK              0
+#define DC2_INVALID_PROBLEM (-1)
+#define DC2_INVALID_CONFIG  (-2)
+
+// Problem to solve, its arrays are only read and must not change until dc2_solve returns.
+typedef struct {
+    // | Number of facilities and clients.
+    int n_facs, n_clis;
+    // | Cost of each facility (n_facs).
+    const double *facility_cost;
+    // | Cost of assigning each client to each facility, facility by facility: costs[f*n_clis+c] (n_facs*n_clis).
+    const double *costs;
+} dc2_problem;
+
+// A solution of the problem.
+typedef struct {
+    // | Value of the solution, its cost multiplied by -1 (like the VALUE of dc's output).
+    double value;
+    // | Open facilities, in increasing order.
+    int n_facs;
+    int *facs;
+    // | Facility assigned to each client (n_clis).
+    int *assigns;
+} dc2_solution;
+
+// Called each time the best solution improves, sol is only valid during the call.
+// With a time limit the best solution is also reported between generations, as dc does on its output file.
+typedef void (*dc2_improvement_callback)(const dc2_solution *sol, double seconds, void *user_data);
+
+// Called after the reduction of each generation of a restart, with its solution size and number of solutions.
+// If it retrieves nonzero the search stops, as if the time limit was reached.
+// With parallel_restarts it is called from different threads at the same time.
+typedef int (*dc2_progress_callback)(int restart, int size, int n_sols, double seconds, void *user_data);
+
+// Configuration of the solver, each field is like a flag of dc (see README.md).
+typedef struct {
+    // | Reduction strategies, with the nomenclature of dc (e.g. "sdbs+:100:pcd"), n_strategies 0 for the default ones.
+    const char **strategies;
+    int n_strategies;
+    // | -r<n>
+    int random_seed;
+    // | -R<n>
+    int restarts;
+    // | -n<n>
+    int target_sols;
+    // | -t<n>
+    int n_threads;
+    // | -p
+    int parallel_restarts;
+    // | -T<s> (0 for no limit), with time_limit_cpu it is -TC<s>
+    double time_limit;
+    int time_limit_cpu;
+    // | -s<n> and -S<n> (-1 for no restriction)
+    int min_size, max_size;
+    // | -f<n>
+    int filter;
+    // | -B<n> (-1 to create all the children)
+    int branching_factor;
+    // | 0 for -BC
+    int branching_correction;
+    // | One of DC2_*_LOCAL_SEARCH or DC2_SWAP_*
+    int local_search;
+    // | -wP, -LP and -WP (-1 for the same as local_search)
+    int local_search_pr;
+    // | -A
+    int local_search_all;
+    // | -aft
+    int local_search_after_select;
+    // | -x
+    int local_search_fixed_size;
+    // | One of DC2_*PATH_RELINKING*
+    int path_relinking;
+    // | -Pk<k> (0 for all the pairs)
+    int pr_partners;
+    // | -Pt<frac>
+    double pr_truncate;
+    // | -Prr
+    int pr_round_robin;
+    // | -H<n> (0 for no memo)
+    long long ls_memo_size;
+    // | -d
+    int delta_solutions;
+    // | -bnb
+    int branch_and_bound;
+    // | -pre
+    int preprocess;
+    // | 0 for -dup
+    int merge_clients;
+    // | Print the progress like dc without -V.
+    int verbose;
+    // | Callbacks (NULL if unused) and the data given to them.
+    dc2_improvement_callback on_improvement;
+    dc2_progress_callback on_progress;
+    void *user_data;
+} dc2_config;
+
+// Result of dc2_solve.
+typedef struct {
+    // | Number of clients of the problem, the size of the assigns of each solution.
+    int n_clis;
+    // | Solutions found, from the best to the worst (up to target_sols).
+    int n_sols;
+    dc2_solution *sols;
+    // | CPU and elapsed seconds of the search.
+    double cpu_seconds, elapsed;
+    // | If the search stopped because of the time limit or the progress callback.
+    int stopped;
+    // | Total number of generations of all the restarts.
+    int n_iterations;
+} dc2_result;
+
+// Sets the default configuration, the same as dc without flags (but not verbose, and with seed 42).
+DC2_API void dc2_config_default(dc2_config *cfg);
+
+// Solves the problem, filling res. Retrieves DC2_OK, or an error code (see dc2_error_string) leaving res empty.
+DC2_API int dc2_solve(const dc2_problem *prob, const dc2_config *cfg, dc2_result *res);
+
+// Frees the arrays of a result.
+DC2_API void dc2_result_free(dc2_result *res);
+
+// Description of an error code of dc2_solve.
+DC2_API const char *dc2_error_string(int code);
+
+// Frees the arrays of a solution.
+DC2_API void dc2_solution_free(dc2_solution *sol);
+
+// A session keeps a solution of a problem that changes, so it can be re-optimized with a local search after each
+// change, instead of solving the problem again. The solution (its assignments and value), the 1st and 2nd nearest
+// facility of each client and the precomputations of the local search are updated on each change.
+// Clients are never merged on a session, and its local search is single threaded.
+typedef struct dc2_session dc2_session;
+
+// Starts a session with a copy of the problem and the solution with the given facilities (e.g. the best solution of
+// a dc2_result). The local search fields, the number of threads (for the precomputations), the random seed and
+// verbose are taken from the configuration. Retrieves NULL if the problem or the solution are invalid.
+DC2_API dc2_session *dc2_session_init(const dc2_problem *prob, const dc2_config *cfg, const int *facs, int n_facs);
+
+// Changes the cost of the facility f.
+DC2_API int dc2_session_set_facility_cost(dc2_session *ses, int f, double cost);
+
+// Changes the costs of assigning the client c to each facility (n_facs costs).
+DC2_API int dc2_session_set_client_costs(dc2_session *ses, int c, const double *costs);
+
+// Adds a client with the given costs for each facility (n_facs costs), retrieving its index.
+DC2_API int dc2_session_add_client(dc2_session *ses, const double *costs);
+
+// Removes the client c, the last client takes its index.
+DC2_API int dc2_session_remove_client(dc2_session *ses, int c);
+
+// Performs a local search from the current solution, retrieving the number of movements performed.
+DC2_API int dc2_session_local_search(dc2_session *ses);
+
+// Number of clients of the current problem.
+DC2_API int dc2_session_n_clis(const dc2_session *ses);
+
+// Copies the current solution, that must be freed with dc2_solution_free.
+DC2_API void dc2_session_get_solution(const dc2_session *ses, dc2_solution *sol);
+
+DC2_API void dc2_session_free(dc2_session *ses);
+
+#endif
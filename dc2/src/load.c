@@ -173,3 +173,68 @@ problem *new_problem_load(const char *file){
 
     return prob;
 }
+
+// Adds the solution with the facilities given on the text, separated by spaces, unless it is empty
+void load_add_solution(const char *file, const problem *prob, const char *text, solution ***sols, int *n_sols){
+    solution *sol = solution_empty(prob);
+    const char *pos = text;
+    while(1){
+        char *end;
+        long f = strtol(pos,&end,10);
+        if(end==pos) break;
+        if(f<0 || f>=prob->n_facs){
+            fprintf(stderr,"ERROR: facility %ld on file \"%s\" is not on the problem!\n",f,file);
+            exit(1);
+        }
+        solution_add(prob,sol,(int)f,NULL);
+        pos = end;
+    }
+    if(sol->n_facs==0){
+        solution_free(sol);
+        return;
+    }
+    // It is terminal unless a child is better
+    sol->terminal = 1;
+    *sols = safe_realloc(*sols,sizeof(solution *)*(*n_sols+1));
+    (*sols)[*n_sols] = sol;
+    *n_sols += 1;
+}
+
+solution **new_solutions_load(const char *file, const problem *prob, int *out_n_sols){
+    FILE *fp = fopen(file,"r");
+    if(fp==NULL){
+        fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",file);
+        exit(1);
+    }
+    int n_sols = 0;
+    solution **sols = safe_malloc(sizeof(solution *)*1);
+    // Output files start with a section header, then only the indexes (or CSV lines) of the solutions are read
+    int is_output = 0;
+    int in_csv = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    while(getline(&line,&line_cap,fp)!=-1){
+        if(strncmp(line,"==",2)==0){
+            is_output = 1;
+        }else if(strncmp(line,"# CSV:",6)==0){
+            in_csv = 1;
+        }else if(strncmp(line,"# INDEXES:",10)==0){
+            load_add_solution(file,prob,&line[10],&sols,&n_sols);
+        }else if(line[0]!='#' && (!is_output || in_csv)){
+            // On CSV lines (VALUE,N_FACS,INDEXES,ASSIGNS) the indexes are the third field
+            const char *text = line;
+            if(in_csv){
+                for(int k=0;k<2 && text!=NULL;k++){
+                    text = strchr(text,',');
+                    if(text!=NULL) text++;
+                }
+                if(text==NULL) continue;
+            }
+            load_add_solution(file,prob,text,&sols,&n_sols);
+        }
+    }
+    free(line);
+    fclose(fp);
+    *out_n_sols = n_sols;
+    return sols;
+}
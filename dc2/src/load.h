@@ -3,8 +3,14 @@
 
 #include "utils.h"
 #include "problem.h"
+#include "solution.h"
 
 // Loads a problem from a given file and performs precomputations.
 problem *new_problem_load(const char *file);
 
+// Loads solutions of the problem from a given file, that can be an output file of dc (in any format) or a list of
+// solutions, one per line, with the indexes of their facilities separated by spaces (lines starting with # are ignored).
+// Facility indexes start from 0, as on the outputs. Empty solutions are ignored.
+solution **new_solutions_load(const char *file, const problem *prob, int *out_n_sols);
+
 #endif
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "localsearch.h"
+#include "reduction.h"
+#include "lsmemo.h"
+#include "profiler.h"
 
 void update_phi1_and_phi2(const problem *prob, const solution *sol, int f_ins, int f_rem,
         int *phi1, int *phi2, int *affected_mask){
@@ -81,33 +84,55 @@ typedef struct {
     solution **sols;
     int n_sols;
     int n_moves;
+    int n_searches;
     shuffler *shuff;
+    int generation;
 } hillclimb_thread_args;
 
 void *hillclimb_thread_execution(void *arg){
     hillclimb_thread_args *args = (hillclimb_thread_args *) arg;
-    if(args->run->local_search==SWAP_RESENDE_WERNECK){
-        if(args->thread_id<args->n_sols){
-            fastmat *mat = fastmat_init(args->run->prob->n_facs,args->run->prob->n_facs);
-            for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
-                // Perform local search on the given solution
-                args->n_moves += solution_resendewerneck_hill_climbing(args->run,&args->sols[r],NULL,mat);
-            }
-            fastmat_free(mat);
+    const rundata *run = args->run;
+    uint64_t prof_start = profiler_now(run->prof);
+    fastmat *mat = NULL;
+    if(run->local_search==SWAP_RESENDE_WERNECK && args->thread_id<args->n_sols){
+        mat = fastmat_init(run->prob->n_facs,run->prob->n_facs);
+    }
+    // Starting facilities of each search, to record them in the memo
+    int *start = NULL;
+    if(run->ls_memo!=NULL) start = safe_malloc(sizeof(int)*(run->prob->n_facs+1));
+    for(int r=args->thread_id;r<args->n_sols;r+=run->n_threads){
+        // The remaining solutions are left as they are when the time is up
+        if(rundata_time_is_up(run)) break;
+        // Skip the search if it was already performed
+        int n_start = 0;
+        uint64_t start_hash = args->sols[r]->hash;
+        if(run->ls_memo!=NULL){
+            if(lsmemo_lookup(run->ls_memo,run->prob,&args->sols[r])) continue;
+            n_start = args->sols[r]->n_facs;
+            memcpy(start,args->sols[r]->facs,sizeof(int)*n_start);
         }
-    }else{
-        for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
-            // Perform local search on the given solution
-            args->n_moves += solution_whitaker_hill_climbing(args->run,&args->sols[r],NULL,args->shuff);
+        // Perform local search on the given solution
+        if(run->local_search==SWAP_RESENDE_WERNECK){
+            args->n_moves += solution_resendewerneck_hill_climbing(run,&args->sols[r],NULL,mat);
+        }else{
+            // The random stream of the search only depends on its starting solution
+            if(args->shuff) shuffler_seed(args->shuff,run->random_seed,start_hash);
+            args->n_moves += solution_whitaker_hill_climbing(run,&args->sols[r],NULL,args->shuff);
         }
+        args->n_searches += 1;
+        if(run->ls_memo!=NULL) lsmemo_insert(run->ls_memo,start,n_start,start_hash,args->sols[r]);
     }
+    if(mat) fastmat_free(mat);
+    free(start);
+    profiler_span(run->prof,PHASE_LOCAL_SEARCH,prof_start,run->prof_set,args->thread_id+1,args->generation,NULL);
     return NULL;
 }
 
 // Perform local searches (in parallel).
-void solutions_hill_climbing(rundata *run, solution **sols, int n_sols){
+void solutions_hill_climbing(rundata *run, solution **sols, int n_sols, int generation){
     // Start measuring time
     clock_t start = clock();
+    uint64_t prof_start = profiler_begin(run->prof,PHASE_LOCAL_SEARCH);
     // Allocate memory for threads and arguments
     pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
     hillclimb_thread_args *targs = safe_malloc(sizeof(hillclimb_thread_args)*run->n_threads);
@@ -119,6 +144,8 @@ void solutions_hill_climbing(rundata *run, solution **sols, int n_sols){
         targs[i].sols = sols;
         targs[i].n_sols = n_sols;
         targs[i].n_moves = 0;
+        targs[i].n_searches = 0;
+        targs[i].generation = generation;
         // Set random number generator for the thread
         if(run->local_search==SWAP_FIRST_IMPROVEMENT){
             targs[i].shuff = shuffler_init(run->prob->n_facs);
@@ -134,9 +161,11 @@ void solutions_hill_climbing(rundata *run, solution **sols, int n_sols){
     }
     // Join threads
     int n_moves = 0;
+    int n_searches = 0;
     for(int i=0;i<run->n_threads;i++){ // Join threads
         pthread_join(threads[i],NULL);
         n_moves += targs[i].n_moves;
+        n_searches += targs[i].n_searches;
     }
     // Free memory
     for(int i=0;i<run->n_threads;i++){
@@ -147,9 +176,10 @@ void solutions_hill_climbing(rundata *run, solution **sols, int n_sols){
     // End measuring time
     clock_t end = clock();
     double seconds = (double)(end - start) / (double)CLOCKS_PER_SEC;
-    run->run_inf->n_local_searches += n_sols;
+    run->run_inf->n_local_searches += n_searches;
     run->run_inf->n_local_search_movements += n_moves;
     run->run_inf->local_search_seconds += seconds;
+    profiler_span(run->prof,PHASE_LOCAL_SEARCH,prof_start,run->prof_set,0,generation,NULL);
 }
 
 
@@ -157,86 +187,260 @@ void solutions_hill_climbing(rundata *run, solution **sols, int n_sols){
 // ======== PATH RELINKING
 // ============================================================================
 
+// A path relinking result, with the nearest facilities of each client if a local search must follow
+typedef struct {
+    solution *sol;
+    int *phi1;
+    int *phi2;
+} prresult;
+
+int prresult_cmp(const void *a, const void *b){
+    const prresult *aa = (const prresult *) a;
+    const prresult *bb = (const prresult *) b;
+    return solutionp_facs_cmp(&aa->sol,&bb->sol);
+}
+
+// A pair of solutions of the pool to be linked, with the number of facilities that differ between them
+typedef struct {
+    int i,j;
+    int cost;
+} prpair;
+
+// Compare pairs to sort them by decreasing cost
+int prpair_cost_cmp_inv(const void *a, const void *b){
+    const prpair *aa = (const prpair *) a;
+    const prpair *bb = (const prpair *) b;
+    if(aa->cost!=bb->cost) return bb->cost - aa->cost;
+    if(aa->i!=bb->i) return aa->i - bb->i;
+    return aa->j - bb->j;
+}
+
+// Creates the pairs of solutions of the pool that will be linked
+prpair *new_path_relinking_pairs(const rundata *run, solution **pool, int n_pool, int *out_n_pairs){
+    // Number of facilities that differ between each pair
+    int *cost = safe_malloc(sizeof(int)*n_pool*n_pool+1);
+    for(int i=0;i<n_pool;i++){
+        cost[i*n_pool+i] = 0;
+        for(int j=i+1;j<n_pool;j++){
+            int d = diff_sorted(pool[i]->facs,pool[i]->n_facs,pool[j]->facs,pool[j]->n_facs);
+            cost[i*n_pool+j] = d;
+            cost[j*n_pool+i] = d;
+        }
+    }
+    // Mark the pairs that will be linked
+    char *linked = safe_malloc(sizeof(char)*n_pool*n_pool+1);
+    int n_pairs = 0;
+    if(run->pr_partners<=0 || run->pr_partners>=n_pool-1){
+        for(int i=0;i<n_pool;i++){
+            for(int j=0;j<n_pool;j++) linked[i*n_pool+j] = i<j;
+        }
+        n_pairs = n_pool*(n_pool-1)/2;
+    }else{
+        // Each solution is linked with its most different partners
+        memset(linked,0,sizeof(char)*n_pool*n_pool);
+        solvalpair *partners = safe_malloc(sizeof(solvalpair)*n_pool);
+        for(int i=0;i<n_pool;i++){
+            int n_partners = 0;
+            for(int j=0;j<n_pool;j++){
+                if(j==i) continue;
+                partners[n_partners].value = cost[i*n_pool+j];
+                partners[n_partners].indx  = j;
+                n_partners++;
+            }
+            solvalpairs_select_bests(partners,n_partners,run->pr_partners);
+            for(int k=0;k<run->pr_partners;k++){
+                int j = partners[k].indx;
+                int a = i<j? i : j;
+                int b = i<j? j : i;
+                if(!linked[a*n_pool+b]){
+                    linked[a*n_pool+b] = 1;
+                    n_pairs++;
+                }
+            }
+        }
+        free(partners);
+    }
+    // Create the pairs
+    prpair *pairs = safe_malloc(sizeof(prpair)*(n_pairs+1));
+    int n = 0;
+    for(int i=0;i<n_pool;i++){
+        for(int j=i+1;j<n_pool;j++){
+            if(!linked[i*n_pool+j]) continue;
+            pairs[n].i = i;
+            pairs[n].j = j;
+            pairs[n].cost = cost[i*n_pool+j];
+            n++;
+        }
+    }
+    assert(n==n_pairs);
+    // The most expensive pairs go first, so the last ones to be assigned are the cheapest
+    if(!run->pr_round_robin) qsort(pairs,n_pairs,sizeof(prpair),prpair_cost_cmp_inv);
+    free(linked);
+    free(cost);
+    *out_n_pairs = n_pairs;
+    return pairs;
+}
+
 typedef struct {
     int thread_id;
     const rundata *run;
     solution **pool;
     int n_pool;
-    solution **result;
+    // Pairs to be linked, and the next one to be picked when they are assigned dynamically
+    prpair *pairs;
+    int n_pairs;
+    int *next_pair;
+    pthread_mutex_t *next_pair_mutex;
+    prresult *result;
+    int n_result;
     shuffler *shuff;
+    // 1st and 2nd nearest facilities for each solution in the pool, if the local search is included
+    int **pool_phi1;
+    int **pool_phi2;
+    int n_ls;
+    int n_ls_moves;
+    int generation;
 } path_relinking_thread_args;
 
 void *path_relinking_thread_execution(void *arg){
     path_relinking_thread_args *args = (path_relinking_thread_args *) arg;
+    const problem *prob = args->run->prob;
+    uint64_t prof_start = profiler_now(args->run->prof);
 
     // Allocate a unique reusable fastmat if SWAP_RESENDE_WERNECK
     fastmat *mat = NULL;
     if(args->run->local_search_pr==SWAP_RESENDE_WERNECK){
-        mat = fastmat_init(args->run->prob->n_facs,args->run->prob->n_facs);
+        mat = fastmat_init(prob->n_facs,prob->n_facs);
     }
 
-    int c_pair = 0;
-    for(int i=0;i<args->n_pool;i++){
-        for(int j=i+1;j<args->n_pool;j++){
-            // Check if this pair should be linked by the current thread
-            if(c_pair%args->run->n_threads==args->thread_id){
-
-                // Pick initial and ending solution from the pair according to solution value
-                const solution *sol_ini, *sol_end;
-                if(args->pool[i]->value >= args->pool[j]->value){
-                    sol_ini = args->pool[i];
-                    sol_end = args->pool[j];
-                }else{
-                    sol_ini = args->pool[j];
-                    sol_end = args->pool[i];
+    int c_pair = args->thread_id - args->run->n_threads;
+    while(1){
+        // Pick the next pair to be linked by the current thread
+        if(args->run->pr_round_robin){
+            c_pair += args->run->n_threads;
+        }else{
+            pthread_mutex_lock(args->next_pair_mutex);
+            c_pair = *args->next_pair;
+            *args->next_pair += 1;
+            pthread_mutex_unlock(args->next_pair_mutex);
+        }
+        if(c_pair>=args->n_pairs) break;
+        int i = args->pairs[c_pair].i;
+        int j = args->pairs[c_pair].j;
+
+        // Pick initial and ending solution from the pair according to solution value
+        int ini = (args->pool[i]->value >= args->pool[j]->value)? i : j;
+        const solution *sol_ini = args->pool[ini];
+        const solution *sol_end = args->pool[i+j-ini];
+
+        // Perform path relinking (the initial solution is kept when the time is up)
+        solution *sol = solution_copy(prob,sol_ini);
+        int *phi1 = NULL;
+        int *phi2 = NULL;
+        if(!rundata_time_is_up(args->run)){
+            if(args->pool_phi1!=NULL){
+                phi1 = safe_malloc(sizeof(int)*prob->n_clis);
+                phi2 = safe_malloc(sizeof(int)*prob->n_clis);
+                solution_resendewerneck_path_relinking(args->run,&sol,sol_end,
+                    args->pool_phi1[ini],args->pool_phi2[ini],mat,phi1,phi2);
+                // A local search is only required if the path had a better solution than the initial one
+                if(sol->value <= sol_ini->value){
+                    free(phi1);
+                    free(phi2);
+                    phi1 = NULL;
+                    phi2 = NULL;
                 }
+            }else if(args->run->local_search_pr==SWAP_RESENDE_WERNECK){
+                solution_resendewerneck_hill_climbing(args->run,&sol,sol_end,mat);
+            }else{
+                // The random stream of the path only depends on its ends
+                if(args->shuff) shuffler_seed(args->shuff,args->run->random_seed,sol_ini->hash^(31*sol_end->hash+1));
+                solution_whitaker_hill_climbing(args->run,&sol,sol_end,args->shuff);
+            }
+        }
 
-                // Perform path relinking
-                solution *sol = solution_copy(args->run->prob,sol_ini);
-                if(args->run->local_search_pr==SWAP_RESENDE_WERNECK){
-                    solution_resendewerneck_hill_climbing(args->run,&sol,sol_end,mat);
-                }else{
-                    solution_whitaker_hill_climbing(args->run,&sol,sol_end,args->shuff);
-                }
+        args->result[c_pair].sol  = sol;
+        args->result[c_pair].phi1 = phi1;
+        args->result[c_pair].phi2 = phi2;
 
-                args->result[c_pair] = sol;
-
-                // Chack that path relinking was performed correctly
-                #ifdef DEBUG
-                    // Check that all facilitites in sol came from one of the solutions
-                    for(int k=0; k<sol->n_facs; k++){
-                        int in_ini = elem_in_sorted(sol_ini->facs,sol_ini->n_facs,sol->facs[k]);
-                        int in_end = elem_in_sorted(sol_end->facs,sol_end->n_facs,sol->facs[k]);
-                        assert(in_ini || in_end);
-                    }
-                    // Check that all facilities in both solutions remain in sol
-                    for(int k=0; k<sol_ini->n_facs; k++){
-                        int f = sol_ini->facs[k];
-                        if(elem_in_sorted(sol_end->facs, sol_end->n_facs, f)){
-                            assert(elem_in_sorted(sol->facs,sol->n_facs,f));
-                        }
-                    }
-                #endif
+        // Chack that path relinking was performed correctly
+        #ifdef DEBUG
+            // Check that all facilitites in sol came from one of the solutions
+            for(int k=0; k<sol->n_facs; k++){
+                int in_ini = elem_in_sorted(sol_ini->facs,sol_ini->n_facs,sol->facs[k]);
+                int in_end = elem_in_sorted(sol_end->facs,sol_end->n_facs,sol->facs[k]);
+                assert(in_ini || in_end);
             }
-            c_pair += 1;
-        }
+            // Check that all facilities in both solutions remain in sol
+            for(int k=0; k<sol_ini->n_facs; k++){
+                int f = sol_ini->facs[k];
+                if(elem_in_sorted(sol_end->facs, sol_end->n_facs, f)){
+                    assert(elem_in_sorted(sol->facs,sol->n_facs,f));
+                }
+            }
+        #endif
     }
 
-    assert(c_pair== args->n_pool*(args->n_pool-1)/2);
-
     if(mat) fastmat_free(mat);
 
+    profiler_span(args->run->prof,PHASE_PATH_RELINKING,prof_start,args->run->prof_set,args->thread_id+1,args->generation,NULL);
+    return NULL;
+}
 
+// Performs the local search on the path relinking results that carry their nearest facilities
+void *path_relinking_local_search_thread_execution(void *arg){
+    path_relinking_thread_args *args = (path_relinking_thread_args *) arg;
+    uint64_t prof_start = profiler_now(args->run->prof);
+    fastmat *mat = fastmat_init(args->run->prob->n_facs,args->run->prob->n_facs);
+    for(int r=args->thread_id;r<args->n_result;r+=args->run->n_threads){
+        prresult *res = &args->result[r];
+        if(res->phi1==NULL) continue;
+        if(!rundata_time_is_up(args->run)){
+            args->n_ls_moves += solution_resendewerneck_hill_climbing_phis(args->run,&res->sol,mat,res->phi1,res->phi2);
+            args->n_ls += 1;
+        }
+        free(res->phi1);
+        free(res->phi2);
+        res->phi1 = NULL;
+        res->phi2 = NULL;
+    }
+    fastmat_free(mat);
+    profiler_span(args->run->prof,PHASE_LOCAL_SEARCH,prof_start,args->run->prof_set,args->thread_id+1,args->generation,NULL);
     return NULL;
 }
 
+int path_relinking_includes_local_search(const rundata *run){
+    return run->local_search_pr==SWAP_RESENDE_WERNECK && run->local_search==SWAP_RESENDE_WERNECK;
+}
+
 // Perform path relinking searches from the current solutions that won't be modified (in parallel).
-void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols){
+void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols, int generation){
     // Start measuring time
     clock_t start = clock();
+    uint64_t prof_start = profiler_begin(run->prof,PHASE_PATH_RELINKING);
+    // Pairs to be linked
+    int n_pairs;
+    prpair *pairs = new_path_relinking_pairs(run,*sols,*n_sols,&n_pairs);
+    int next_pair = 0;
+    pthread_mutex_t next_pair_mutex;
+    pthread_mutex_init(&next_pair_mutex,NULL);
     // Allocate memory for resulting set of solutions
-    int n_resulting = (*n_sols)*((*n_sols)-1)/2;
-    solution **resulting = safe_malloc(sizeof(solution*)*n_resulting);
+    int n_resulting = n_pairs;
+    prresult *resulting = safe_malloc(sizeof(prresult)*(n_resulting+1));
+
+    // Compute the nearest facilities of each solution in the pool once, they are carried to the local search
+    int **pool_phi1 = NULL;
+    int **pool_phi2 = NULL;
+    int include_ls = path_relinking_includes_local_search(run);
+    if(include_ls){
+        pool_phi1 = safe_malloc(sizeof(int *)*(*n_sols));
+        pool_phi2 = safe_malloc(sizeof(int *)*(*n_sols));
+        for(int i=0;i<(*n_sols);i++){
+            pool_phi1[i] = safe_malloc(sizeof(int)*run->prob->n_clis);
+            pool_phi2[i] = safe_malloc(sizeof(int)*run->prob->n_clis);
+            solution_compute_phi1_and_phi2(run->prob,(*sols)[i],pool_phi1[i],pool_phi2[i]);
+        }
+    }
 
     // Allocate memory for threads and arguments
     pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
@@ -249,7 +453,17 @@ void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols){
         targs[i].run = run;
         targs[i].pool = (*sols);
         targs[i].n_pool = (*n_sols);
+        targs[i].pairs = pairs;
+        targs[i].n_pairs = n_pairs;
+        targs[i].next_pair = &next_pair;
+        targs[i].next_pair_mutex = &next_pair_mutex;
         targs[i].result = resulting;
+        targs[i].n_result = n_resulting;
+        targs[i].pool_phi1 = pool_phi1;
+        targs[i].pool_phi2 = pool_phi2;
+        targs[i].n_ls = 0;
+        targs[i].n_ls_moves = 0;
+        targs[i].generation = generation;
         if(run->local_search_pr==SWAP_FIRST_IMPROVEMENT){
             targs[i].shuff = shuffler_init(run->prob->n_facs);
         }else{
@@ -268,6 +482,54 @@ void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols){
     for(int i=0;i<run->n_threads;i++){
         pthread_join(threads[i],NULL);
     }
+    pthread_mutex_destroy(&next_pair_mutex);
+    free(pairs);
+
+    // Delete similar solutions
+    if(n_resulting>0){
+        qsort(resulting,n_resulting,sizeof(prresult),prresult_cmp);
+        int n_final = 1;
+        for(int i=1;i<n_resulting;i++){
+            if(prresult_cmp(&resulting[n_final-1],&resulting[i])!=0){
+                resulting[n_final] = resulting[i];
+                n_final++;
+            }else{
+                // Keep the copy with nearest facilities, if any (the assignments of ties may differ between copies)
+                if(resulting[n_final-1].phi1==NULL){
+                    prresult aux = resulting[n_final-1];
+                    resulting[n_final-1] = resulting[i];
+                    resulting[i] = aux;
+                }
+                free(resulting[i].phi1);
+                free(resulting[i].phi2);
+                solution_free(resulting[i].sol);
+            }
+        }
+        n_resulting = n_final;
+    }
+
+    // Perform the local search on the different results, starting from the nearest facilities found on the path
+    if(include_ls){
+        for(int i=0;i<run->n_threads;i++){
+            targs[i].n_result = n_resulting;
+            int rc = pthread_create(&threads[i],NULL,path_relinking_local_search_thread_execution,&targs[i]);
+            if(rc){
+                fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
+                exit(1);
+            }
+        }
+        for(int i=0;i<run->n_threads;i++){
+            pthread_join(threads[i],NULL);
+            run->run_inf->n_local_searches += targs[i].n_ls;
+            run->run_inf->n_local_search_movements += targs[i].n_ls_moves;
+        }
+        for(int i=0;i<(*n_sols);i++){
+            free(pool_phi1[i]);
+            free(pool_phi2[i]);
+        }
+        free(pool_phi1);
+        free(pool_phi2);
+    }
 
     // Free memory
     for(int i=0;i<run->n_threads;i++){
@@ -280,9 +542,7 @@ void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols){
     clock_t end = clock();
     double seconds = (double)(end - start) / (double)CLOCKS_PER_SEC;
     run->run_inf->path_relinking_seconds += seconds;
-
-    // Delete similar solutions
-    solutions_sort_and_delete_repeated(resulting,&n_resulting);
+    profiler_span(run->prof,PHASE_PATH_RELINKING,prof_start,run->prof_set,0,generation,NULL);
 
     // Delete original solutions
     for(int i=0;i<(*n_sols);i++){
@@ -291,7 +551,10 @@ void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols){
     free(*sols);
 
     // Replace the original solution array for the array of resulting solutions
-    *sols = resulting;
+    solution **result_sols = safe_malloc(sizeof(solution *)*(n_resulting+1));
+    for(int i=0;i<n_resulting;i++) result_sols[i] = resulting[i].sol;
+    free(resulting);
+    *sols = result_sols;
     *n_sols = n_resulting;
 }
 
@@ -359,9 +622,19 @@ availmoves *availmoves_init(const problem *prob, const solution *sol, const solu
     // Won't recover indexes unless tgt is NULL
     av->path_relinking = (tgt!=NULL);
 
+    av->moves_left = -1;
+
     return av;
 }
 
+void availmoves_truncate(availmoves *av, double fraction){
+    if(fraction>=1) return;
+    // Each movement is an insertion, a removal or both
+    int n_moves = av->n_insertions>av->n_removals? av->n_insertions : av->n_removals;
+    av->moves_left = (int) ceil(fraction*n_moves);
+    if(av->moves_left<1) av->moves_left = 1;
+}
+
 void availmoves_register_move(availmoves *av, int f_ins, int f_rem){
     // Update used array
     if(f_ins>=0){
@@ -428,6 +701,15 @@ void availmoves_register_move(availmoves *av, int f_ins, int f_rem){
             av->n_insertions += 1;
         }
     }
+
+    // Stop if the limit of movements was reached
+    if(av->moves_left>0){
+        av->moves_left -= 1;
+        if(av->moves_left==0){
+            av->n_insertions = 0;
+            av->n_removals   = 0;
+        }
+    }
 }
 
 void availmoves_free(availmoves *av){
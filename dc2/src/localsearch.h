@@ -23,9 +23,13 @@ typedef struct {
     int *avail_rems;
     // If a facility is present in the solution
     int *used;
+    // Movements left before stopping (-1 for no limit)
+    int moves_left;
 } availmoves;
 
 availmoves *availmoves_init(const problem *prob, const solution *sol, const solution *tgt);
+// Limits the number of movements to the given fraction of the ones required to reach the target
+void availmoves_truncate(availmoves *av, double fraction);
 void availmoves_register_move(availmoves *av, int f_ins, int f_rem);
 void availmoves_free(availmoves *av);
 
@@ -38,6 +42,22 @@ void fastmat_free(fastmat *mat);
 // requires a fastmat of size (prob->n_facs,prob->n_facs) initialized in zeros (retrieves it the same way so it can be reused).
 int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp, const solution *target, fastmat *zeroini_mat);
 
+// Performs path relinking from *solp to target using Resende & Werneck local search, starting from
+// phi1_ini and phi2_ini, the 1st and 2nd nearest facility to each client on *solp (they are not modified).
+// *solp is replaced by the best solution on the path and best_phi1 and best_phi2 retrieve its nearest
+// facilities, so a following local search doesn't have to compute them again.
+int solution_resendewerneck_path_relinking(const rundata *run, solution **solp, const solution *target,
+        const int *phi1_ini, const int *phi2_ini, fastmat *zeroini_mat, int *best_phi1, int *best_phi2);
+
+// Performs hill climbing using Resende & Werneck local search, given the 1st and 2nd nearest facility to each
+// client on *solp, which are updated.
+int solution_resendewerneck_hill_climbing_phis(const rundata *run, solution **solp, fastmat *zeroini_mat,
+        int *phi1, int *phi2);
+
+// If the path relinking also performs the local search on its results, as both are Resende & Werneck's.
+// The solutions that are linked are expected to be local optima already.
+int path_relinking_includes_local_search(const rundata *run);
+
 // Performs hill climbing via facility swapings using Whitaker's fast exchange heuristic
 // If a shuffler is provided, 1st improvement is assumed.
 int solution_whitaker_hill_climbing(const rundata *run, solution **solp, const solution *target, shuffler *shuff);
@@ -45,11 +65,11 @@ int solution_whitaker_hill_climbing(const rundata *run, solution **solp, const s
 // Sort the given array and delete repeated solutions
 void solutions_sort_and_delete_repeated(solution **sols, int *n_sols);
 
-// Perform local searches (in parallel).
-void solutions_hill_climbing(rundata *run, solution **sols, int n_sols);
+// Perform local searches (in parallel), generation is only used to label the profiler spans.
+void solutions_hill_climbing(rundata *run, solution **sols, int n_sols, int generation);
 
-// Perform path relinking (in parallel).
-void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols);
+// Perform path relinking (in parallel), generation is only used to label the profiler spans.
+void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols, int generation);
 
 
 // Updates phi1 and phi2 (arrays with 1st and 2nd nearest solution facility to each client)
@@ -130,11 +130,14 @@ void update_structures(
     int fr    = sol->assigns[u];
     double d_phi1 = problem_assig_cost(prob,phi1[u],u);
     double d_phi2 = problem_assig_cost(prob,phi2[u],u);
-    assert(fr>=0 && avail->used[fr]);
+    // The client may be unassigned (fr = -1) when row -1 is finite (see preprocess.h), it is like a facility
+    // that is always open and can't be removed
+    assert(fr==-1 || avail->used[fr]);
     assert(d_phi2>=d_phi1);
     assert(phi1[u]==fr);
+    int rem_fr = fr!=-1 && avail->avail_rems[fr];
 
-    if(avail->avail_rems[fr]){
+    if(rem_fr){
         if(!undo){
             loss[fr] += d_phi2 - d_phi1;
         }else{
@@ -172,19 +175,19 @@ void update_structures(
         if(d_fi < d_phi1){
             if(!undo){
                 gain[fi] += d_phi1 - d_fi;
-                if(avail->avail_rems[fr]) fastmat_add(extra,fi,fr,d_phi2-d_phi1);
+                if(rem_fr) fastmat_add(extra,fi,fr,d_phi2-d_phi1);
             }else{
                 gain[fi] -= d_phi1 - d_fi;
                 #ifdef DEBUG
                     assert(gain[fi]>=-1e-6);
                 #endif
-                if(avail->avail_rems[fr]) fastmat_rem(extra,fi,fr,d_phi2-d_phi1);
+                if(rem_fr) fastmat_rem(extra,fi,fr,d_phi2-d_phi1);
             }
         }else{
             if(!undo){
-                if(avail->avail_rems[fr]) fastmat_add(extra,fi,fr,d_phi2-d_fi);
+                if(rem_fr) fastmat_add(extra,fi,fr,d_phi2-d_fi);
             }else{
-                if(avail->avail_rems[fr]) fastmat_rem(extra,fi,fr,d_phi2-d_fi);
+                if(rem_fr) fastmat_rem(extra,fi,fr,d_phi2-d_fi);
             }
         }
     }
@@ -246,17 +249,15 @@ double find_best_neighboor(
     return best_delta;
 }
 
-int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp,const solution *target, fastmat *zeroini_mat){
-    solution *sol = *solp;
+/* Performs the search from *solp, given the 1st and 2nd nearest facility to each client, which are updated.
+If target is not NULL, performs path relinking and *solp is replaced by the best solution on the path,
+if best_phi1 and best_phi2 are not NULL, they retrieve the phi arrays for that solution. */
+int resendewerneck_search(const rundata *run, solution **solp, const solution *target, fastmat *zeroini_mat,
+        int *phi1, int *phi2, int *best_phi1, int *best_phi2){
     const problem *prob = run->prob;
+    solution_make_writable(prob,solp);
+    solution *sol = *solp;
     if(sol->n_facs<2) return 0;
-    // First and Second nearest facility to each client
-    int *phi1 = safe_malloc(sizeof(int)*prob->n_clis);
-    int *phi2 = safe_malloc(sizeof(int)*prob->n_clis);
-    for(int i=0;i<prob->n_clis;i++){
-        phi1[i] = sol->assigns[i];
-        phi2[i] = solution_client_2nd_nearest(prob,sol,i);
-    }
 
     // Structures
     assert(zeroini_mat->n_nonzeros==0);
@@ -286,11 +287,16 @@ int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp,co
 
     // Available moves
     availmoves *avail = availmoves_init(prob,sol,target);
+    if(avail->path_relinking) availmoves_truncate(avail,run->pr_truncate);
 
     // Best solution found so far (if doing path relinking):
     solution *best_sol = NULL;
     if(avail->path_relinking){
         best_sol = solution_copy(prob,sol);
+        if(best_phi1!=NULL){
+            memcpy(best_phi1,phi1,sizeof(int)*prob->n_clis);
+            memcpy(best_phi2,phi2,sizeof(int)*prob->n_clis);
+        }
     }
 
     while(avail->n_insertions>0 || avail->n_removals>0){
@@ -351,12 +357,19 @@ int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp,co
         }
         availmoves_register_move(avail,best_ins,best_rem);
 
+        // Update phi1 and phi2
+        update_phi1_and_phi2(prob,sol,best_ins,best_rem,phi1,phi2,affected_mask);
+
         // Update best solution so far (if doing path relinking)
         if(avail->path_relinking){
             assert(best_sol);
             if(best_sol->value < sol->value){
                 solution_free(best_sol);
                 best_sol = solution_copy(prob,sol);
+                if(best_phi1!=NULL){
+                    memcpy(best_phi1,phi1,sizeof(int)*prob->n_clis);
+                    memcpy(best_phi2,phi2,sizeof(int)*prob->n_clis);
+                }
             }
         }
 
@@ -369,9 +382,6 @@ int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp,co
             }
         #endif
 
-        // Update phi1 and phi2
-        update_phi1_and_phi2(prob,sol,best_ins,best_rem,phi1,phi2,affected_mask);
-
         // Count one move:
         n_moves += 1;
     }
@@ -388,18 +398,52 @@ int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp,co
     availmoves_free(avail);
     free(loss);
     free(gain);
-    free(phi2);
-    free(phi1);
 
     // Set sol to best_sol in case we are doing path relinking
     if(best_sol!=NULL){
         *solp = best_sol;
         #ifdef DEBUG
             // Assert that the target was reached
-            if(target!=NULL) assert(solutionp_facs_cmp(&sol,&target)==0);
+            if(target!=NULL && run->pr_truncate>=1) assert(solutionp_facs_cmp(&sol,&target)==0);
         #endif
         solution_free(sol);
     }
 
     return n_moves;
 }
+
+int solution_resendewerneck_hill_climbing(const rundata *run, solution **solp, const solution *target, fastmat *zeroini_mat){
+    const problem *prob = run->prob;
+    if((*solp)->n_facs<2) return 0;
+    // First and Second nearest facility to each client
+    int *phi1 = safe_malloc(sizeof(int)*prob->n_clis);
+    int *phi2 = safe_malloc(sizeof(int)*prob->n_clis);
+    solution_compute_phi1_and_phi2(prob,*solp,phi1,phi2);
+    int n_moves = resendewerneck_search(run,solp,target,zeroini_mat,phi1,phi2,NULL,NULL);
+    free(phi2);
+    free(phi1);
+    return n_moves;
+}
+
+int solution_resendewerneck_path_relinking(const rundata *run, solution **solp, const solution *target,
+        const int *phi1_ini, const int *phi2_ini, fastmat *zeroini_mat, int *best_phi1, int *best_phi2){
+    const problem *prob = run->prob;
+    if((*solp)->n_facs<2){
+        memcpy(best_phi1,phi1_ini,sizeof(int)*prob->n_clis);
+        memcpy(best_phi2,phi2_ini,sizeof(int)*prob->n_clis);
+        return 0;
+    }
+    int *phi1 = safe_malloc(sizeof(int)*prob->n_clis);
+    int *phi2 = safe_malloc(sizeof(int)*prob->n_clis);
+    memcpy(phi1,phi1_ini,sizeof(int)*prob->n_clis);
+    memcpy(phi2,phi2_ini,sizeof(int)*prob->n_clis);
+    int n_moves = resendewerneck_search(run,solp,target,zeroini_mat,phi1,phi2,best_phi1,best_phi2);
+    free(phi2);
+    free(phi1);
+    return n_moves;
+}
+
+int solution_resendewerneck_hill_climbing_phis(const rundata *run, solution **solp, fastmat *zeroini_mat,
+        int *phi1, int *phi2){
+    return resendewerneck_search(run,solp,NULL,zeroini_mat,phi1,phi2,NULL,NULL);
+}
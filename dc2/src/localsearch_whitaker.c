@@ -3,8 +3,9 @@
 #define NO_MOVEMENT (-2)
 
 int solution_whitaker_hill_climbing(const rundata *run, solution **solp, const solution *target, shuffler *shuff){
-    solution *sol = *solp;
     const problem *prob = run->prob;
+    solution_make_writable(prob,solp);
+    solution *sol = *solp;
 
     // Is this first improvement?
     int first_improvement = shuff!=NULL;
@@ -26,6 +27,7 @@ int solution_whitaker_hill_climbing(const rundata *run, solution **solp, const s
 
     // Available moves
     availmoves *avail = availmoves_init(prob,sol,target);
+    if(avail->path_relinking) availmoves_truncate(avail,run->pr_truncate);
 
     // Best solution found so far (if doing path relinking):
     solution *best_sol = NULL;
@@ -90,7 +92,7 @@ int solution_whitaker_hill_climbing(const rundata *run, solution **solp, const s
             best_rem = NO_MOVEMENT;
             #ifdef DEBUG
                 // Assert that the target was reached
-                if(target!=NULL) assert(solutionp_facs_cmp(&sol,&target)==0);
+                if(target!=NULL && run->pr_truncate>=1) assert(solutionp_facs_cmp(&sol,&target)==0);
             #endif
         }
 
@@ -147,7 +149,7 @@ int solution_whitaker_hill_climbing(const rundata *run, solution **solp, const s
         *solp = best_sol;
         #ifdef DEBUG
             // Assert that the target was reached
-            if(target!=NULL) assert(solutionp_facs_cmp(&sol,&target)==0);
+            if(target!=NULL && run->pr_truncate>=1) assert(solutionp_facs_cmp(&sol,&target)==0);
         #endif
         solution_free(sol);
     }
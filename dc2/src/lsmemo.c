@@ -0,0 +1,138 @@
+#include "lsmemo.h"
+
+// Number of mutexes protecting the buckets, so threads rarely wait for each other
+#define LSMEMO_N_LOCKS 64
+
+typedef struct lsmemo_entry lsmemo_entry;
+
+struct lsmemo_entry {
+    uint64_t hash;
+    int n_start;
+    int n_opt;
+    // Facilities of the start, followed by the ones of the local optimum
+    int *facs;
+    lsmemo_entry *next;
+};
+
+struct lsmemo {
+    int n_buckets;
+    lsmemo_entry **buckets;
+    pthread_mutex_t locks[LSMEMO_N_LOCKS];
+    // Counters of the buckets protected by each lock
+    long long n_entries[LSMEMO_N_LOCKS];
+    long long n_hits[LSMEMO_N_LOCKS];
+    long long n_lookups[LSMEMO_N_LOCKS];
+    // Maximum number of entries for the buckets of each lock
+    long long max_entries;
+};
+
+lsmemo *lsmemo_init(long long max_entries){
+    lsmemo *memo = safe_malloc(sizeof(lsmemo));
+    memo->n_buckets = 1;
+    while(memo->n_buckets<max_entries && memo->n_buckets<(1<<24)) memo->n_buckets *= 2;
+    memo->buckets = safe_malloc(sizeof(lsmemo_entry *)*memo->n_buckets);
+    memset(memo->buckets,0,sizeof(lsmemo_entry *)*memo->n_buckets);
+    for(int i=0;i<LSMEMO_N_LOCKS;i++){
+        pthread_mutex_init(&memo->locks[i],NULL);
+        memo->n_entries[i] = 0;
+        memo->n_hits[i]    = 0;
+        memo->n_lookups[i] = 0;
+    }
+    memo->max_entries = (max_entries+LSMEMO_N_LOCKS-1)/LSMEMO_N_LOCKS;
+    return memo;
+}
+
+void lsmemo_free(lsmemo *memo){
+    for(int i=0;i<memo->n_buckets;i++){
+        lsmemo_entry *entry = memo->buckets[i];
+        while(entry!=NULL){
+            lsmemo_entry *next = entry->next;
+            free(entry->facs);
+            free(entry);
+            entry = next;
+        }
+    }
+    for(int i=0;i<LSMEMO_N_LOCKS;i++) pthread_mutex_destroy(&memo->locks[i]);
+    free(memo->buckets);
+    free(memo);
+}
+
+// Finds the entry with the given start, the lock of its bucket must be held
+static lsmemo_entry *lsmemo_find(lsmemo *memo, uint64_t hash, const int *facs, int n_facs){
+    lsmemo_entry *entry = memo->buckets[hash&(memo->n_buckets-1)];
+    while(entry!=NULL){
+        if(entry->hash==hash && entry->n_start==n_facs &&
+                memcmp(entry->facs,facs,sizeof(int)*n_facs)==0) return entry;
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+int lsmemo_lookup(lsmemo *memo, const problem *prob, solution **solp){
+    const solution *sol = *solp;
+    uint64_t hash = sol->hash;
+    int bucket = hash&(memo->n_buckets-1);
+    int l = bucket%LSMEMO_N_LOCKS;
+    // Copy the local optimum while holding the lock
+    int n_opt = -1;
+    int *opt_facs = NULL;
+    pthread_mutex_lock(&memo->locks[l]);
+    lsmemo_entry *entry = lsmemo_find(memo,hash,sol->facs,sol->n_facs);
+    if(entry!=NULL){
+        n_opt = entry->n_opt;
+        opt_facs = safe_malloc(sizeof(int)*(n_opt+1));
+        memcpy(opt_facs,&entry->facs[entry->n_start],sizeof(int)*n_opt);
+    }
+    memo->n_lookups[l] += 1;
+    if(entry!=NULL) memo->n_hits[l] += 1;
+    pthread_mutex_unlock(&memo->locks[l]);
+    if(opt_facs==NULL) return 0;
+    // Build the local optimum, unless it is the same solution
+    if(n_opt!=sol->n_facs || memcmp(opt_facs,sol->facs,sizeof(int)*n_opt)!=0){
+        solution *opt = solution_empty(prob);
+        for(int k=0;k<n_opt;k++) solution_add(prob,opt,opt_facs[k],NULL);
+        opt->terminal = sol->terminal;
+        solution_free(*solp);
+        *solp = opt;
+    }
+    free(opt_facs);
+    return 1;
+}
+
+// Adds an entry for the given start if it is not already there
+static void lsmemo_insert_single(lsmemo *memo, const int *start, int n_start, uint64_t hash, const solution *opt){
+    int bucket = hash&(memo->n_buckets-1);
+    int l = bucket%LSMEMO_N_LOCKS;
+    pthread_mutex_lock(&memo->locks[l]);
+    if(memo->n_entries[l]<memo->max_entries && lsmemo_find(memo,hash,start,n_start)==NULL){
+        lsmemo_entry *entry = safe_malloc(sizeof(lsmemo_entry));
+        entry->hash = hash;
+        entry->n_start = n_start;
+        entry->n_opt = opt->n_facs;
+        entry->facs = safe_malloc(sizeof(int)*(n_start+opt->n_facs+1));
+        memcpy(entry->facs,start,sizeof(int)*n_start);
+        memcpy(&entry->facs[n_start],opt->facs,sizeof(int)*opt->n_facs);
+        entry->next = memo->buckets[bucket];
+        memo->buckets[bucket] = entry;
+        memo->n_entries[l] += 1;
+    }
+    pthread_mutex_unlock(&memo->locks[l]);
+}
+
+void lsmemo_insert(lsmemo *memo, const int *start, int n_start, uint64_t start_hash, const solution *opt){
+    lsmemo_insert_single(memo,start,n_start,start_hash,opt);
+    if(n_start!=opt->n_facs || memcmp(start,opt->facs,sizeof(int)*n_start)!=0){
+        lsmemo_insert_single(memo,opt->facs,opt->n_facs,opt->hash,opt);
+    }
+}
+
+void lsmemo_stats(lsmemo *memo, long long *n_hits, long long *n_lookups){
+    *n_hits = 0;
+    *n_lookups = 0;
+    for(int i=0;i<LSMEMO_N_LOCKS;i++){
+        pthread_mutex_lock(&memo->locks[i]);
+        *n_hits    += memo->n_hits[i];
+        *n_lookups += memo->n_lookups[i];
+        pthread_mutex_unlock(&memo->locks[i]);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef DC_LSMEMO_H
+#define DC_LSMEMO_H
+
+#include <stdint.h>
+
+#include "utils.h"
+#include "solution.h"
+
+// A concurrent hash table that maps the solutions from which a local search started (and the local optima
+// themselves) to the local optima they reached, so searches repeated across generations and restarts are skipped.
+// It is keyed by the Zobrist hash of the facilities, but the facilities are always compared on a hit.
+// (lsmemo is declared on rundata.h, as the rundata keeps the one shared by the whole run)
+
+// Creates an empty memo that stores up to max_entries searches.
+lsmemo *lsmemo_init(long long max_entries);
+void lsmemo_free(lsmemo *memo);
+
+// If the facilities of *solp are in the memo, *solp is replaced by the cached local optimum and 1 is returned.
+int lsmemo_lookup(lsmemo *memo, const problem *prob, solution **solp);
+
+// Records that the local search from the facilities start (with the given hash) reached opt,
+// and that opt is a local optimum.
+void lsmemo_insert(lsmemo *memo, const int *start, int n_start, uint64_t start_hash, const solution *opt);
+
+// Number of lookups that were found in the memo and total number of lookups
+void lsmemo_stats(lsmemo *memo, long long *n_hits, long long *n_lookups);
+
+#endif
@@ -4,6 +4,9 @@
 #include "reduction.h"
 #include "construction.h"
 #include "output.h"
+#include "lsmemo.h"
+#include "preprocess.h"
+#include "profiler.h"
 
 #include <time.h>
 #include <sys/time.h>
@@ -24,6 +27,8 @@ int main(int argc, const char **argv){
     // Filenames
     const char *input_fname = argv[argc-2];
     const char *output_fname = argv[argc-1];
+    int n_init_fnames = 0;
+    const char **init_fnames = safe_malloc(sizeof(const char *)*argc);
 
     // Problem arguments to be changed by command line arguments
     const int UNSET = -2;
@@ -46,6 +51,23 @@ int main(int argc, const char **argv){
     int branching_correction = UNSET;
     int path_relinking = UNSET;
     int only_1_output_sol = UNSET;
+    int parallel_restarts = UNSET;
+    double time_limit = UNSET;
+    int time_limit_cpu = UNSET;
+    double checkpoint_interval = UNSET;
+    int resume = UNSET;
+    int pr_partners = UNSET;
+    double pr_truncate = UNSET;
+    int pr_round_robin = UNSET;
+    long long ls_memo_size = UNSET;
+    int delta_solutions = UNSET;
+    int preprocess = UNSET;
+    int merge_clients = UNSET;
+    int output_csv = UNSET;
+    int trace = UNSET;
+    int hw_counters = UNSET;
+    int init_local_search = UNSET;
+    int init_start = UNSET;
 
     // Parse arguments
     for(int i=1;i<argc-2;i++){
@@ -83,6 +105,35 @@ int main(int argc, const char **argv){
                    exit(1);
                 }
                 assert(branching>=-2);
+            }else if(argv[i][1]=='T' && argv[i][2]=='C'){
+                // CPU time limit
+                int n_read = sscanf(argv[i],"-TC%lf",&time_limit);
+                if(n_read<1 || time_limit<=0){
+                   fprintf(stderr,"ERROR: expected CPU time limit in seconds on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
+                time_limit_cpu = 1;
+            }else if(argv[i][1]=='T'){
+                // Elapsed time limit
+                int n_read = sscanf(argv[i],"-T%lf",&time_limit);
+                if(n_read<1 || time_limit<=0){
+                   fprintf(stderr,"ERROR: expected time limit in seconds on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
+                time_limit_cpu = 0;
+            }else if(argv[i][1]=='K'){
+                // Checkpoint interval
+                int n_read = sscanf(argv[i],"-K%lf",&checkpoint_interval);
+                if(n_read<1 || checkpoint_interval<=0){
+                   fprintf(stderr,"ERROR: expected checkpoint interval in seconds on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
+            }else if(argv[i][1]=='-' && strcmp(argv[i],"--resume")==0){
+                // Resume from the checkpoint
+                resume = 1;
+            }else if(argv[i][1]=='t' && strcmp(argv[i],"-trace")==0){
+                // Profile the phases
+                trace = 1;
             }else if(argv[i][1]=='t'){
                 // Number of threads
                 int n_read = sscanf(argv[i],"-t%d",&n_threads);
@@ -117,8 +168,7 @@ int main(int argc, const char **argv){
                 assert(bnb==UNSET);
                 bnb = 0;
             }else if(argv[i][1]=='b' && strcmp(argv[i],"-bnb")==0){
-                // Enable branch and bound
-                // NOTE: hidden feature, it has not proven useful. Maybe with a better algorith,
+                // Enable branch and bound, with dual ascent bounds
                 assert(bnb==UNSET);
                 bnb = 1;
             }else if(argv[i][1]=='l' && strcmp(argv[i],"-l")==0){
@@ -162,6 +212,23 @@ int main(int argc, const char **argv){
                 // Don't allow local search to perform movements that change the size
                 local_search_rem_movement = 0;
                 local_search_add_movement = 0;
+            }else if(argv[i][1]=='P' && strcmp(argv[i],"-Prr")==0){
+                // Assign path relinking pairs to threads in round robin, instead of dynamically by cost
+                pr_round_robin = 1;
+            }else if(argv[i][1]=='P' && argv[i][2]=='k'){
+                // Number of most different partners linked with each solution
+                int n_read = sscanf(argv[i],"-Pk%d",&pr_partners);
+                if(n_read<1 || pr_partners<1){
+                   fprintf(stderr,"ERROR: expected positive number of partners on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
+            }else if(argv[i][1]=='P' && argv[i][2]=='t'){
+                // Fraction of each path that is explored
+                int n_read = sscanf(argv[i],"-Pt%lf",&pr_truncate);
+                if(n_read<1 || pr_truncate<=0 || pr_truncate>1){
+                   fprintf(stderr,"ERROR: expected fraction in (0,1] on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
             }else if(argv[i][1]=='P' && strcmp(argv[i],"-P")==0){
                 // Enable 1 path relinking
                 assert(path_relinking==UNSET);
@@ -170,6 +237,48 @@ int main(int argc, const char **argv){
                 // Enable path relinking until no better solution is found made
                 assert(path_relinking==UNSET);
                 path_relinking = PATH_RELINKING_UNTIL_NO_BETTER;
+            }else if(argv[i][1]=='H'){
+                // Memo of the local searches already performed
+                ls_memo_size = DEFAULT_LS_MEMO_SIZE;
+                if(argv[i][2]!='\0'){
+                    int n_read = sscanf(argv[i],"-H%lld",&ls_memo_size);
+                    if(n_read<1 || ls_memo_size<1){
+                       fprintf(stderr,"ERROR: expected positive memo size on argument \"%s\".\n",argv[i]);
+                       exit(1);
+                    }
+                }
+            }else if(argv[i][1]=='d' && strcmp(argv[i],"-d")==0){
+                // Children solutions share the assignments of their parents
+                delta_solutions = 1;
+            }else if(argv[i][1]=='p' && strcmp(argv[i],"-perf")==0){
+                // Measure hardware counters on each phase
+                hw_counters = 1;
+            }else if(argv[i][1]=='c' && strcmp(argv[i],"-csv")==0){
+                // Save solutions as CSV lines
+                output_csv = 1;
+            }else if(argv[i][1]=='d' && strcmp(argv[i],"-dup")==0){
+                // Keep clients with the same costs as different clients
+                merge_clients = 0;
+            }else if(argv[i][1]=='p' && strcmp(argv[i],"-pre")==0){
+                // Reduce the problem before the search
+                preprocess = 1;
+            }else if(argv[i][1]=='p' && strcmp(argv[i],"-p")==0){
+                // Distribute restarts between threads
+                parallel_restarts = 1;
+            }else if(argv[i][1]=='i'){
+                // Initial solutions file
+                if(argv[i][2]=='\0'){
+                   fprintf(stderr,"ERROR: expected file name on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
+                init_fnames[n_init_fnames] = &argv[i][2];
+                n_init_fnames++;
+            }else if(argv[i][1]=='I' && strcmp(argv[i],"-Ils")==0){
+                // Local search on the initial solutions before the search
+                init_local_search = 1;
+            }else if(argv[i][1]=='I' && strcmp(argv[i],"-Istart")==0){
+                // Restarts start from the initial solutions
+                init_start = 1;
             }else if(argv[i][1]=='V' && strcmp(argv[i],"-V")==0){
                 // Non verbose mode
                 verbose = 0;
@@ -190,11 +299,74 @@ int main(int argc, const char **argv){
     if(n_threads<0) n_threads = DEFAULT_THREADS;
     if(verbose<0) verbose = 1;
 
+    // Start the profiler before reading the problem
+    profiler *prof = NULL;
+    if(trace!=UNSET || hw_counters!=UNSET){
+        // A set of rings for the main thread, and one for each restart worker with -p
+        int n_prof_sets = (parallel_restarts!=UNSET && parallel_restarts)? 1+n_threads : 1;
+        prof = profiler_init(n_prof_sets,n_threads,hw_counters!=UNSET);
+        if(hw_counters!=UNSET && prof->perf==NULL){
+            fprintf(stderr,"WARNING: hardware counters are not available.\n");
+        }
+    }
+
     // Read problem and set size restrictions
+    uint64_t prof_start = profiler_begin(prof,PHASE_LOAD);
     problem *prob = new_problem_load(input_fname);
+    profiler_span(prof,PHASE_LOAD,prof_start,0,0,-1,NULL);
     if(min_size>=0) prob->size_restriction_minimum = min_size;
     if(max_size>=0) prob->size_restriction_maximum = max_size;
 
+    // Read the initial solutions
+    int n_init_sols = 0;
+    solution **init_sols = safe_malloc(sizeof(solution *)*1);
+    for(int k=0;k<n_init_fnames;k++){
+        int n_file_sols;
+        solution **file_sols = new_solutions_load(init_fnames[k],prob,&n_file_sols);
+        if(n_file_sols==0) fprintf(stderr,"WARNING: no solutions on file \"%s\".\n",init_fnames[k]);
+        init_sols = safe_realloc(init_sols,sizeof(solution *)*(n_init_sols+n_file_sols+1));
+        for(int i=0;i<n_file_sols;i++) init_sols[n_init_sols++] = file_sols[i];
+        free(file_sols);
+    }
+
+    // Reduce the problem, the search is performed on the reduced one
+    preprocessing *prepro = NULL;
+    problem *orig_prob = NULL; // Kept for the preprocessing
+    prof_start = profiler_begin(prof,PHASE_PREPROCESS);
+    if(preprocess!=UNSET || merge_clients==UNSET){
+        prepro = preprocessing_init(prob,preprocess!=UNSET,verbose);
+        if(preprocessing_is_trivial(prepro)){
+            // Nothing was reduced, the original problem is used
+            preprocessing_free(prepro);
+            prepro = NULL;
+        }else{
+            orig_prob = prob;
+            prob = problem_copy(prepro->prob);
+        }
+    }
+    profiler_span(prof,PHASE_PREPROCESS,prof_start,0,0,-1,NULL);
+
+    // The initial solutions are used on the reduced problem, if they satisfy its size restrictions
+    int n_valid_init_sols = 0;
+    for(int i=0;i<n_init_sols;i++){
+        solution *sol = init_sols[i];
+        if(prepro!=NULL){
+            sol = preprocessing_reduce_solution(prepro,init_sols[i]);
+            solution_free(init_sols[i]);
+        }
+        int min_size_ok = prob->size_restriction_minimum==-1 || sol->n_facs>=prob->size_restriction_minimum;
+        int max_size_ok = prob->size_restriction_maximum==-1 || sol->n_facs<=prob->size_restriction_maximum;
+        if(sol->n_facs>0 && min_size_ok && max_size_ok){
+            init_sols[n_valid_init_sols++] = sol;
+        }else{
+            solution_free(sol);
+        }
+    }
+    if(n_valid_init_sols<n_init_sols){
+        fprintf(stderr,"WARNING: %d initial solutions ignored, their size is not valid.\n",n_init_sols-n_valid_init_sols);
+    }
+    n_init_sols = n_valid_init_sols;
+
     // See if the nearly indexes should be precomputed
     int precomp_nearly_indexes = 0;
     if(local_search==SWAP_RESENDE_WERNECK) precomp_nearly_indexes = 1;
@@ -206,14 +378,15 @@ int main(int argc, const char **argv){
     // FIXME: ^ it is not nice that this has to be computed before intiializing the rundata.
     // It is a form of coupling.
 
-    // Initialize the rundata and perform the precomputations
+    // Initialize the rundata and perform the precomputations (rundata keeps the problem)
+    prof_start = profiler_begin(prof,PHASE_PRECOMP);
     rundata *run = rundata_init(prob, strategies,n_strategies,restarts,precomp_nearly_indexes,n_threads,verbose);
-
-    // Free problem (rundata kepps a copy)
-    problem_free(prob);
+    profiler_span(prof,PHASE_PRECOMP,prof_start,0,0,-1,NULL);
+    run->prof = prof;
     prob = NULL;
 
     // Set console arguments
+    run->prepro = prepro;
     if(target_n!=UNSET) run->target_sols = target_n;
     if(filter_n!=UNSET) run->filter = filter_n;
     if(bnb!=UNSET) run->branch_and_bound = bnb;
@@ -224,6 +397,7 @@ int main(int argc, const char **argv){
     if(local_search_rem_movement!=UNSET) run->local_search_rem_movement = local_search_rem_movement;
     if(local_search_add_movement!=UNSET) run->local_search_add_movement = local_search_add_movement;
     if(verbose!=UNSET) run->verbose = verbose;
+    if(output_csv!=UNSET) run->output_csv = output_csv;
     if(branching!=UNSET) run->branching_factor = branching;
     if(path_relinking!=UNSET) run->path_relinking = path_relinking;
     if(local_search_pr==UNSET){ // If PR local search is unset, make it equal to the normal local search
@@ -232,6 +406,40 @@ int main(int argc, const char **argv){
         run->local_search_pr = local_search_pr;
     }
     if(branching_correction!=UNSET) run->branching_correction = branching_correction;
+    if(parallel_restarts!=UNSET) run->parallel_restarts = parallel_restarts;
+    // The phases of parallel restarts overlap, so their counters can't be told apart
+    if(run->parallel_restarts && run->prof!=NULL && run->prof->perf!=NULL){
+        fprintf(stderr,"WARNING: hardware counters are not measured with parallel restarts.\n");
+        perfcounters_free(run->prof->perf);
+        run->prof->perf = NULL;
+    }
+    if(pr_partners!=UNSET) run->pr_partners = pr_partners;
+    if(pr_truncate!=UNSET) run->pr_truncate = pr_truncate;
+    if(pr_round_robin!=UNSET) run->pr_round_robin = pr_round_robin;
+    if(delta_solutions!=UNSET) run->delta_solutions = delta_solutions;
+    if(ls_memo_size!=UNSET) run->ls_memo = lsmemo_init(ls_memo_size);
+    run->init_sols = init_sols;
+    run->n_init_sols = n_init_sols;
+    if(init_local_search!=UNSET) run->init_local_search = init_local_search;
+    if(init_start!=UNSET) run->init_start = init_start;
+    char *checkpoint_fname = NULL;
+    if(checkpoint_interval!=UNSET || resume!=UNSET){
+        if(run->parallel_restarts){
+            fprintf(stderr,"ERROR: checkpoints are not supported with parallel restarts.\n");
+            exit(1);
+        }
+        checkpoint_fname = safe_malloc(strlen(output_fname)+6);
+        sprintf(checkpoint_fname,"%s.ckpt",output_fname);
+        run->checkpoint_fname = checkpoint_fname;
+        if(checkpoint_interval!=UNSET) run->checkpoint_interval = checkpoint_interval;
+        if(resume!=UNSET) run->resume = resume;
+    }
+    if(time_limit!=UNSET){
+        run->time_limit = time_limit;
+        run->time_limit_cpu = time_limit_cpu;
+        // Keep the best solution on the output file as the search goes
+        run->anytime_fname = output_fname;
+    }
     if(only_1_output_sol==UNSET) only_1_output_sol = 0;
 
     // Check that there is no specification of path relinking if we are not using it
@@ -250,6 +458,7 @@ int main(int argc, const char **argv){
     clock_t start = clock();
     struct timeval elapsed_start;
     gettimeofday(&elapsed_start,NULL);
+    rundata_start_timer(run);
     // ---@>
 
     // Print current run info:
@@ -276,27 +485,61 @@ int main(int argc, const char **argv){
 
     if(run->verbose) printf("\n");
 
+    // Retrieve the solutions of the original problem
+    if(run->prepro!=NULL){
+        for(int i=0;i<final_n_sols;i++){
+            solution *orig_sol = preprocessing_map_solution(run->prepro,final_sols[i]);
+            solution_free(final_sols[i]);
+            final_sols[i] = orig_sol;
+        }
+    }
+
     int virt_mem_usage_peak;
     get_memory_usage(NULL,NULL,NULL,&virt_mem_usage_peak);
 
     // Save output
+    prof_start = profiler_begin(run->prof,PHASE_OUTPUT);
     save_solutions(output_fname,
         run,final_sols,final_n_sols,input_fname,
         seconds,elapsed_seconds,virt_mem_usage_peak,
         strategies,n_strategies, only_1_output_sol);
 
-    // Print output
-    save_solutions(NULL,
-        run,final_sols,final_n_sols,input_fname,
-        seconds,elapsed_seconds,virt_mem_usage_peak,
-        strategies,n_strategies, only_1_output_sol);
+    profiler_span(run->prof,PHASE_OUTPUT,prof_start,0,0,-1,NULL);
+    // The profile is appended once the output is measured
+    if(run->prof!=NULL) save_profile(output_fname,run);
+
+    // Save the timeline of the phases
+    if(run->prof!=NULL && trace!=UNSET){
+        char *trace_fname = safe_malloc(strlen(output_fname)+12);
+        sprintf(trace_fname,"%s.trace.json",output_fname);
+        if(run->verbose) printf("Saving trace on \"%s\"...\n",trace_fname);
+        profiler_save_trace(run->prof,trace_fname);
+        free(trace_fname);
+    }
+
+    // Print output, unless on non verbose mode
+    if(run->verbose){
+        save_solutions(NULL,
+            run,final_sols,final_n_sols,input_fname,
+            seconds,elapsed_seconds,virt_mem_usage_peak,
+            strategies,n_strategies, only_1_output_sol);
+        if(run->prof!=NULL) save_profile(NULL,run);
+    }
+
+    // The checkpoint is no longer needed
+    if(checkpoint_fname){
+        remove(checkpoint_fname);
+        free(checkpoint_fname);
+    }
 
     // Free memory
     for(int i=0;i<final_n_sols;i++){
         solution_free(final_sols[i]);
     }
     rundata_free(run);
+    if(orig_prob!=NULL) problem_free(orig_prob);
     free(final_sols);
     free(strategies);
     free(strategy_args);
+    free(init_fnames);
 }
@@ -0,0 +1,419 @@
+#include "problem.h"
+#include "redstrategy.h"
+#include "rundata.h"
+#include "solution.h"
+#include "expand.h"
+#include "reduction.h"
+#include "localsearch.h"
+#include "shuffle.h"
+
+/*
+The bench is a self-contained microbenchmark of the main kernels of dc.
+It generates a synthetic instance like the ones of Koerkel-Ghosh (see
+experiment1/koerkel_ghosh/kggensym.c) with a fixed seed, so no instance
+files are needed, and measures the time per operation of each kernel
+over several repetitions, after some warm-up ones.
+*/
+
+#include <time.h>
+
+#define BENCH_DEFAULT_SIZE 250
+#define BENCH_DEFAULT_REPS 10
+#define BENCH_DEFAULT_WARMUP 2
+#define BENCH_DEFAULT_SEED 123456
+#define BENCH_POOL_SIZE 100
+#define BENCH_REDUCTION_INPUT 1000
+
+// Strategies whose reduction is measured, they receive the expansion of the fixed pool
+const char *bench_redstrategies[] = {
+    "rand:100",
+    "rand1:100",
+    "rank:100",
+    "rank1:100",
+    "best:100",
+    "sdbs:100:pcd",
+    "sdbs+:100:pcd",
+    "sdbs+:100:mgesum",
+    "vrh:100:pcd",
+};
+#define BENCH_N_REDSTRATEGIES (int)(sizeof(bench_redstrategies)/sizeof(bench_redstrategies[0]))
+
+typedef struct {
+    rundata *run;
+    ranxoshi256 rngen;
+    int k;
+    // ^ Size of the solutions that are used.
+    solution *base;
+    // ^ Solution of size k to which facilities are added and removed.
+    int *phi1, *phi2;
+    // ^ Nearest and second nearest facility of base for each client.
+    int *outs;
+    int n_outs;
+    // ^ Facilities that are not in base.
+    double *v;
+    // ^ Auxiliary array for solution_findout.
+    solution **pool;
+    // ^ Fixed pool of random solutions of size k.
+    solution **expanded;
+    int n_expanded;
+    // ^ Best solutions of the expansion of the fixed pool, the input of the reductions.
+    fastmat *mat;
+    shuffler *shuff;
+    int red_idx;
+    redstrategy *rstrats;
+} benchctx;
+
+typedef struct {
+    const char *name;
+    long long ops;
+    // ^ Operations on each repetition.
+    int reps;
+    double ns_median, ns_min, ns_mean;
+    // ^ Nanoseconds per operation over the repetitions.
+} benchresult;
+
+// Function that performs one repetition of a benchmark, returning the nanoseconds spent on the
+// measured operations and setting the number of them on *ops.
+typedef double (*benchfunc)(benchctx *ctx, long long *ops);
+
+static inline double bench_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return 1e9*ts.tv_sec+ts.tv_nsec;
+}
+
+// Creates a problem with the same distribution as kggensym, with costs between
+// f_lo and f_hi for facilities and c_lo and c_hi for the assignments.
+problem *bench_kg_problem(int n, double f_lo, double f_hi, double c_lo, double c_hi, unsigned long long seed){
+    ranxoshi256 rngen;
+    rngen_seed(&rngen,seed);
+    problem *prob = problem_init(n,n);
+    for(int i=0;i<n;i++){
+        prob->facility_cost[i] = (int)(ranxoshi256DoubleCC(&rngen)*(f_hi-f_lo)+f_lo);
+    }
+    for(int i=0;i<n;i++){
+        for(int j=0;j<n;j++){
+            prob->distance_cost[i][j] = (int)(ranxoshi256DoubleCC(&rngen)*(c_hi-c_lo)+c_lo);
+        }
+    }
+    return prob;
+}
+
+// Creates a random solution of size k
+solution *bench_random_solution(benchctx *ctx, int k){
+    const problem *prob = ctx->run->prob;
+    solution *sol = solution_empty(prob);
+    while(sol->n_facs<k){
+        int f = rngen_below(&ctx->rngen,prob->n_facs);
+        int present = 0;
+        for(int i=0;i<sol->n_facs;i++) present |= sol->facs[i]==f;
+        if(!present) solution_add(prob,sol,f,NULL);
+    }
+    return sol;
+}
+
+double bench_solution_add(benchctx *ctx, long long *ops){
+    // Add all the facilities that are not in base, one after the other
+    const problem *prob = ctx->run->prob;
+    solution *sol = solution_copy(prob,ctx->base);
+    double start = bench_now();
+    for(int i=0;i<ctx->n_outs;i++) solution_add(prob,sol,ctx->outs[i],NULL);
+    double ns = bench_now()-start;
+    solution_free(sol);
+    *ops = ctx->n_outs;
+    return ns;
+}
+
+double bench_solution_remove(benchctx *ctx, long long *ops){
+    // Remove all the facilities of base, one after the other
+    const problem *prob = ctx->run->prob;
+    solution *sol = solution_copy(prob,ctx->base);
+    double start = bench_now();
+    for(int i=ctx->k-1;i>=0;i--) solution_remove(prob,sol,ctx->base->facs[i],NULL,NULL);
+    double ns = bench_now()-start;
+    solution_free(sol);
+    *ops = ctx->k;
+    return ns;
+}
+
+double bench_solution_findout(benchctx *ctx, long long *ops){
+    // Find the best removal for each facility that is not in base
+    const problem *prob = ctx->run->prob;
+    int f_rem;
+    double profit, profit_worem;
+    double checksum = 0;
+    double start = bench_now();
+    for(int i=0;i<ctx->n_outs;i++){
+        solution_findout(prob,ctx->base,ctx->outs[i],ctx->v,ctx->phi2,NULL,&f_rem,&profit,&profit_worem);
+        checksum += profit;
+    }
+    double ns = bench_now()-start;
+    if(checksum==INFINITY) printf("%lf\n",checksum); // Avoid the loop from being optimized out
+    *ops = ctx->n_outs;
+    return ns;
+}
+
+double bench_update_phi1_and_phi2(benchctx *ctx, long long *ops){
+    // Alternate between base and base swapping a facility, updating the phis each time
+    const problem *prob = ctx->run->prob;
+    int *phi1 = safe_malloc(sizeof(int)*prob->n_clis);
+    int *phi2 = safe_malloc(sizeof(int)*prob->n_clis);
+    memcpy(phi1,ctx->phi1,sizeof(int)*prob->n_clis);
+    memcpy(phi2,ctx->phi2,sizeof(int)*prob->n_clis);
+    int f_a = ctx->base->facs[0];
+    int f_b = ctx->outs[0];
+    solution *swapped = solution_copy(prob,ctx->base);
+    solution_add(prob,swapped,f_b,NULL);
+    solution_remove(prob,swapped,f_a,NULL,NULL);
+    long long n_ops = 0;
+    double start = bench_now();
+    for(int i=0;i<ctx->n_outs;i++){
+        update_phi1_and_phi2(prob,swapped,f_b,f_a,phi1,phi2,NULL);
+        update_phi1_and_phi2(prob,ctx->base,f_a,f_b,phi1,phi2,NULL);
+        n_ops += 2;
+    }
+    double ns = bench_now()-start;
+    solution_free(swapped);
+    free(phi1);
+    free(phi2);
+    *ops = n_ops;
+    return ns;
+}
+
+double bench_resendewerneck_hill_climbing(benchctx *ctx, long long *ops){
+    // Perform the local search starting from a random solution of the pool
+    solution *sol = solution_copy(ctx->run->prob,ctx->pool[rngen_below(&ctx->rngen,BENCH_POOL_SIZE)]);
+    double start = bench_now();
+    solution_resendewerneck_hill_climbing(ctx->run,&sol,NULL,ctx->mat);
+    double ns = bench_now()-start;
+    solution_free(sol);
+    *ops = 1;
+    return ns;
+}
+
+double bench_whitaker_hill_climbing(benchctx *ctx, long long *ops){
+    // Perform the local search starting from a random solution of the pool
+    solution *sol = solution_copy(ctx->run->prob,ctx->pool[rngen_below(&ctx->rngen,BENCH_POOL_SIZE)]);
+    double start = bench_now();
+    solution_whitaker_hill_climbing(ctx->run,&sol,NULL,ctx->shuff);
+    double ns = bench_now()-start;
+    solution_free(sol);
+    *ops = 1;
+    return ns;
+}
+
+double bench_expand(benchctx *ctx, long long *ops){
+    // Expand the fixed pool
+    int n_sols;
+    double start = bench_now();
+    solution **sols = new_expand_solutions(ctx->run,ctx->pool,BENCH_POOL_SIZE,&n_sols,BENCH_POOL_SIZE,&ctx->rngen);
+    double ns = bench_now()-start;
+    for(int i=0;i<n_sols;i++) solution_free(sols[i]);
+    free(sols);
+    *ops = 1;
+    return ns;
+}
+
+double bench_reduction(benchctx *ctx, long long *ops){
+    // Reduce a copy of the expanded pool, as the reductions free the discarded solutions
+    const problem *prob = ctx->run->prob;
+    solution **sols = safe_malloc(sizeof(solution *)*ctx->n_expanded);
+    for(int i=0;i<ctx->n_expanded;i++) sols[i] = solution_copy(prob,ctx->expanded[i]);
+    int n_sols = ctx->n_expanded;
+    double start = bench_now();
+    reduce_by_redstrategy(ctx->run,ctx->rstrats[ctx->red_idx],sols,&n_sols,&ctx->rngen);
+    double ns = bench_now()-start;
+    for(int i=0;i<n_sols;i++) solution_free(sols[i]);
+    free(sols);
+    *ops = 1;
+    return ns;
+}
+
+int double_cmp(const void *a, const void *b){
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x>y)-(x<y);
+}
+
+// Runs a benchmark with the given warm-up and repetitions
+benchresult bench_run(benchctx *ctx, const char *name, benchfunc func, int warmup, int reps){
+    long long ops = 0;
+    for(int i=0;i<warmup;i++) func(ctx,&ops);
+    double *ns_per_op = safe_malloc(sizeof(double)*reps);
+    benchresult res;
+    res.name = name;
+    res.reps = reps;
+    res.ns_mean = 0;
+    for(int i=0;i<reps;i++){
+        double ns = func(ctx,&ops);
+        ns_per_op[i] = ns/ops;
+        res.ns_mean += ns_per_op[i]/reps;
+    }
+    res.ops = ops;
+    qsort(ns_per_op,reps,sizeof(double),double_cmp);
+    res.ns_min = ns_per_op[0];
+    res.ns_median = reps%2==1? ns_per_op[reps/2] : 0.5*(ns_per_op[reps/2-1]+ns_per_op[reps/2]);
+    free(ns_per_op);
+    return res;
+}
+
+void bench_print(const benchresult *results, int n_results, FILE *fp){
+    fprintf(fp,"== BENCHMARKS ==\n");
+    fprintf(fp,"# %-36s %10s %14s %14s %14s %14s\n","NAME","OPS/REP","NS/OP_MEDIAN","NS/OP_MIN","NS/OP_MEAN","OPS/S");
+    for(int i=0;i<n_results;i++){
+        const benchresult *res = &results[i];
+        fprintf(fp,"# %-36s %10lld %14.1lf %14.1lf %14.1lf %14.1lf\n",res->name,res->ops,
+            res->ns_median,res->ns_min,res->ns_mean,1e9/res->ns_median);
+    }
+}
+
+void bench_print_json(const benchresult *results, int n_results, int size, int seed, int n_threads, FILE *fp){
+    fprintf(fp,"{\n");
+    fprintf(fp,"  \"instance\": {\"generator\": \"kg_a\", \"n_facilities\": %d, \"n_clients\": %d, \"seed\": %d},\n",
+        size,size,seed);
+    fprintf(fp,"  \"n_threads\": %d,\n",n_threads);
+    fprintf(fp,"  \"benchmarks\": [\n");
+    for(int i=0;i<n_results;i++){
+        const benchresult *res = &results[i];
+        fprintf(fp,"    {\"name\": \"%s\", \"ops_per_rep\": %lld, \"reps\": %d, ",res->name,res->ops,res->reps);
+        fprintf(fp,"\"ns_per_op_median\": %.1lf, \"ns_per_op_min\": %.1lf, \"ns_per_op_mean\": %.1lf, ",
+            res->ns_median,res->ns_min,res->ns_mean);
+        fprintf(fp,"\"ops_per_sec\": %.1lf}%s\n",1e9/res->ns_median,i<n_results-1? "," : "");
+    }
+    fprintf(fp,"  ]\n");
+    fprintf(fp,"}\n");
+}
+
+int main(int argc, const char **argv){
+    int size = BENCH_DEFAULT_SIZE;
+    int reps = BENCH_DEFAULT_REPS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    int seed = BENCH_DEFAULT_SEED;
+    int n_threads = 1;
+    const char *json_fname = NULL;
+
+    // Read arguments
+    for(int i=1;i<argc;i++){
+        int good = 1;
+        if(strcmp(argv[i],"-json")==0){
+            if(i+1>=argc) good = 0;
+            else json_fname = argv[++i];
+        }
+        else if(argv[i][0]=='-' && argv[i][1]=='n'){
+            good = sscanf(argv[i],"-n%d",&size)==1 && size>=10;
+        }
+        else if(argv[i][0]=='-' && argv[i][1]=='r'){
+            good = sscanf(argv[i],"-r%d",&reps)==1 && reps>0;
+        }
+        else if(argv[i][0]=='-' && argv[i][1]=='w'){
+            good = sscanf(argv[i],"-w%d",&warmup)==1 && warmup>=0;
+        }
+        else if(argv[i][0]=='-' && argv[i][1]=='s'){
+            good = sscanf(argv[i],"-s%d",&seed)==1;
+        }
+        else if(argv[i][0]=='-' && argv[i][1]=='t'){
+            good = sscanf(argv[i],"-t%d",&n_threads)==1 && n_threads>0;
+        }
+        else{
+            good = 0;
+        }
+        if(!good){
+            fprintf(stderr,"usage: %s [-n<size>] [-r<reps>] [-w<warmup>] [-s<seed>] [-t<threads>] [-json <file>]\n",argv[0]);
+            exit(1);
+        }
+    }
+
+    // Create the instance, as the ones of class A of Koerkel-Ghosh
+    problem *prob = bench_kg_problem(size,100,200,1000,2000,seed);
+
+    // Initialize run data, with all the precomputations that the kernels may need
+    benchctx ctx;
+    ctx.rstrats = safe_malloc(sizeof(redstrategy)*BENCH_N_REDSTRATEGIES);
+    for(int i=0;i<BENCH_N_REDSTRATEGIES;i++){
+        ctx.rstrats[i] = redstrategy_from_nomenclature(bench_redstrategies[i]);
+    }
+    ctx.run = rundata_init(prob,ctx.rstrats,BENCH_N_REDSTRATEGIES,1,1,n_threads,0);
+    ctx.run->time_limit = 0;
+    rngen_seed(&ctx.rngen,seed);
+
+    // Base solution and its complement
+    ctx.k = size/10;
+    ctx.base = bench_random_solution(&ctx,ctx.k);
+    ctx.phi1 = safe_malloc(sizeof(int)*prob->n_clis);
+    ctx.phi2 = safe_malloc(sizeof(int)*prob->n_clis);
+    solution_compute_phi1_and_phi2(prob,ctx.base,ctx.phi1,ctx.phi2);
+    ctx.outs = safe_malloc(sizeof(int)*prob->n_facs);
+    ctx.n_outs = 0;
+    for(int f=0;f<prob->n_facs;f++){
+        int present = 0;
+        for(int i=0;i<ctx.base->n_facs;i++) present |= ctx.base->facs[i]==f;
+        if(!present) ctx.outs[ctx.n_outs++] = f;
+    }
+    ctx.v = safe_malloc(sizeof(double)*prob->n_facs);
+    for(int f=0;f<prob->n_facs;f++) ctx.v[f] = -INFINITY;
+
+    // Fixed pool and its expansion
+    ctx.pool = safe_malloc(sizeof(solution *)*BENCH_POOL_SIZE);
+    for(int i=0;i<BENCH_POOL_SIZE;i++) ctx.pool[i] = bench_random_solution(&ctx,ctx.k);
+    ctx.expanded = new_expand_solutions(ctx.run,ctx.pool,BENCH_POOL_SIZE,&ctx.n_expanded,BENCH_POOL_SIZE,&ctx.rngen);
+    int n_children = ctx.n_expanded;
+    reduction_bests(ctx.run,ctx.expanded,&ctx.n_expanded,BENCH_REDUCTION_INPUT);
+    for(int i=0;i<ctx.n_expanded;i++) solution_make_writable(prob,&ctx.expanded[i]);
+
+    ctx.mat = fastmat_init(prob->n_facs,prob->n_facs);
+    ctx.shuff = shuffler_init(prob->n_facs);
+
+    printf("Benchmarking on a generated instance of size %d (seed %d), %d solutions expanded to %d.\n",
+        size,seed,BENCH_POOL_SIZE,n_children);
+    printf("Reductions start from the best %d of them.\n",ctx.n_expanded);
+
+    // Run benchmarks
+    int n_results = 0;
+    benchresult *results = safe_malloc(sizeof(benchresult)*(8+BENCH_N_REDSTRATEGIES));
+    results[n_results++] = bench_run(&ctx,"solution_add",bench_solution_add,warmup,reps);
+    results[n_results++] = bench_run(&ctx,"solution_remove",bench_solution_remove,warmup,reps);
+    results[n_results++] = bench_run(&ctx,"solution_findout",bench_solution_findout,warmup,reps);
+    results[n_results++] = bench_run(&ctx,"update_phi1_and_phi2",bench_update_phi1_and_phi2,warmup,reps);
+    results[n_results++] = bench_run(&ctx,"resendewerneck_hill_climbing",bench_resendewerneck_hill_climbing,warmup,reps);
+    results[n_results++] = bench_run(&ctx,"whitaker_hill_climbing",bench_whitaker_hill_climbing,warmup,reps);
+    results[n_results++] = bench_run(&ctx,"expand_solutions",bench_expand,warmup,reps);
+    char **red_names = safe_malloc(sizeof(char *)*BENCH_N_REDSTRATEGIES);
+    for(int i=0;i<BENCH_N_REDSTRATEGIES;i++){
+        red_names[i] = safe_malloc(strlen(bench_redstrategies[i])+11);
+        sprintf(red_names[i],"reduction %s",bench_redstrategies[i]);
+        ctx.red_idx = i;
+        results[n_results++] = bench_run(&ctx,red_names[i],bench_reduction,warmup,reps);
+    }
+
+    // Print results
+    printf("\n");
+    bench_print(results,n_results,stdout);
+    if(json_fname!=NULL){
+        FILE *fp = strcmp(json_fname,"-")==0? stdout : fopen(json_fname,"w");
+        if(fp==NULL){
+            fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",json_fname);
+            exit(1);
+        }
+        bench_print_json(results,n_results,size,seed,n_threads,fp);
+        if(fp!=stdout) fclose(fp);
+    }
+
+    // Free memory
+    for(int i=0;i<BENCH_N_REDSTRATEGIES;i++) free(red_names[i]);
+    free(red_names);
+    free(results);
+    shuffler_free(ctx.shuff);
+    fastmat_free(ctx.mat);
+    for(int i=0;i<ctx.n_expanded;i++) solution_free(ctx.expanded[i]);
+    free(ctx.expanded);
+    for(int i=0;i<BENCH_POOL_SIZE;i++) solution_free(ctx.pool[i]);
+    free(ctx.pool);
+    free(ctx.v);
+    free(ctx.outs);
+    free(ctx.phi1);
+    free(ctx.phi2);
+    solution_free(ctx.base);
+    rundata_free(ctx.run);
+    free(ctx.rstrats);
+    return 0;
+}
@@ -1,4 +1,25 @@
 #include "output.h"
+#include "lsmemo.h"
+#include "dualbound.h"
+#include "preprocess.h"
+#include "profiler.h"
+
+// Prints a solution in the format selected for the run
+void print_solution(const rundata *run, const problem *prob, const solution *sol, FILE *fp){
+    if(run->output_csv){
+        solution_print_csv(prob,sol,fp);
+    }else{
+        fprintf(fp,"\n");
+        solution_print(prob,sol,fp);
+    }
+}
+
+// Prints the header of the solutions data
+void print_solutions_header(const rundata *run, int n_sols, FILE *fp){
+    fprintf(fp,"== SOLUTIONS DATA ==\n");
+    fprintf(fp,"# OUTPUT_SOLUTIONS: %d\n",n_sols);
+    if(run->output_csv) fprintf(fp,"# CSV: VALUE,N_FACS,INDEXES,ASSIGNS\n");
+}
 
 float get_delta_seconds(struct timeval tv1, struct timeval tv2){
     struct timeval tvdiff = {tv2.tv_sec-tv1.tv_sec,tv2.tv_usec-tv1.tv_usec};
@@ -10,6 +31,47 @@ float get_delta_seconds(struct timeval tv1, struct timeval tv2){
     return secs;
 }
 
+// Prints the trace of improvements of the best solution
+void print_improvements(const rundata *run, FILE *fp){
+    fprintf(fp,"== IMPROVEMENTS INFO ==\n");
+    fprintf(fp,"# TIME_LIMIT_REACHED: %d\n",run->run_inf->time_limit_reached);
+    fprintf(fp,"# N_IMPROVEMENTS: %d\n",run->run_inf->n_improvements);
+    for(int i=0;i<run->run_inf->n_improvements;i++){
+        fprintf(fp,"# IMP %lf %lf\n",run->run_inf->improvement_times[i],run->run_inf->improvement_values[i]);
+    }
+}
+
+void save_best_so_far(const char *file, const rundata *run, const solution *sol){
+    // Write on a temporary file and then replace the original, so it is never left incomplete
+    char *tmp_file = safe_malloc(strlen(file)+5);
+    sprintf(tmp_file,"%s.tmp",file);
+    FILE *fp = fopen(tmp_file,"w");
+    if(fp==NULL){
+        fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",tmp_file);
+        exit(1);
+    }
+    rundata_print(run,fp);
+    fprintf(fp,"# ELAPSED: %f\n",rundata_seconds(run));
+    fprintf(fp,"\n");
+    print_improvements(run,fp);
+    fprintf(fp,"\n");
+    print_solutions_header(run,1,fp);
+    if(run->prepro!=NULL){
+        // Print the solution of the original problem
+        solution *orig_sol = preprocessing_map_solution(run->prepro,sol);
+        print_solution(run,run->prepro->orig,orig_sol,fp);
+        solution_free(orig_sol);
+    }else{
+        print_solution(run,run->prob,sol,fp);
+    }
+    fclose(fp);
+    if(rename(tmp_file,file)!=0){
+        fprintf(stderr,"ERROR: couldn't replace file \"%s\"!\n",file);
+        exit(1);
+    }
+    free(tmp_file);
+}
+
 void save_solutions(const char *file,
         const rundata *run, solution **sols, int n_sols,
         const char *input_file, float seconds, float elapsed, int mem_usage,
@@ -47,12 +109,26 @@ void save_solutions(const char *file,
     fprintf(fp,"# LOCAL_SEARCH_CPU_TIME: %f\n",run->run_inf->local_search_seconds);
     fprintf(fp,"# N_LOCAL_SEARCHES: %lld\n",run->run_inf->n_local_searches);
     fprintf(fp,"# AVG_LOCAL_SEARCH_MOVES: %f\n",(double)run->run_inf->n_local_search_movements/(double)run->run_inf->n_local_searches);
+    long long memo_hits = 0, memo_lookups = 0;
+    if(run->ls_memo!=NULL) lsmemo_stats(run->ls_memo,&memo_hits,&memo_lookups);
+    fprintf(fp,"# LOCAL_SEARCH_MEMO_HITS: %lld / %lld\n",memo_hits,memo_lookups);
     fprintf(fp,"\n");
 
     /* PATH RELINKING INFO */
     fprintf(fp,"== PATH RELINKING INFO ==\n");
     fprintf(fp,"# PATH_RELINKING_CPU_TIME: %f\n",run->run_inf->path_relinking_seconds);
 
+    /* BOUND INFO */
+    // Upper bound for the value of any solution, and relative gap with the best solution
+    double upper_bound = run->dual_bound!=NULL? run->dual_bound->root_bound : run->precomp->precomp_client_optimal_gain;
+    double best_value = n_sols>0? sols[0]->value : -INFINITY;
+    double gap = (upper_bound-best_value)/fmax(1.0,fabs(best_value));
+    fprintf(fp,"== BOUND INFO ==\n");
+    fprintf(fp,"# UPPER_BOUND: %lf\n",upper_bound);
+    fprintf(fp,"# GAP: %lf\n",gap);
+    fprintf(fp,"# N_BNB_PRUNED: %lld\n",run->run_inf->n_bnb_pruned);
+    fprintf(fp,"\n");
+
     /* FIRST RESTART DATA */
     fprintf(fp,"== FIRST RESTART INFO ==\n");
     fprintf(fp,"# FIRST_ITERATIONS: %d\n",run->run_inf->firstr_n_iterations);
@@ -84,14 +160,17 @@ void save_solutions(const char *file,
     }
     fprintf(fp,"\n");
 
+    /* IMPROVEMENTS TRACE */
+    print_improvements(run,fp);
+    fprintf(fp,"\n");
 
     /* SOLUTIONS DATA */
-    fprintf(fp,"== SOLUTIONS DATA ==\n");
-    fprintf(fp,"# OUTPUT_SOLUTIONS: %d\n",n_sols);
+    print_solutions_header(run,n_sols,fp);
+    // The solutions are expected to be already mapped to the original problem
+    const problem *out_prob = run->prepro!=NULL? run->prepro->orig : run->prob;
     for(int i=0;i<n_sols;i++){
         if(i==0 || !only_1_output_sol){
-            fprintf(fp,"\n");
-            solution_print(run->prob,sols[i],fp);
+            print_solution(run,out_prob,sols[i],fp);
         }
     }
     // Close file descriptor
@@ -99,3 +178,23 @@ void save_solutions(const char *file,
         fclose(fp);
     }
 }
+
+void save_profile(const char *file, const rundata *run){
+    FILE *fp = stdout;
+    if(file){
+        fp = fopen(file,"a");
+        if(fp==NULL){
+            fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",file);
+            exit(1);
+        }
+    }
+    fprintf(fp,"\n");
+    profiler_print_summary(run->prof,run->n_threads,fp);
+    if(run->prof->perf!=NULL){
+        fprintf(fp,"\n");
+        perfcounters_print(run->prof->perf,profphase_names,fp);
+    }
+    if(fp!=stdout){
+        fclose(fp);
+    }
+}
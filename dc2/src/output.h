@@ -10,6 +10,10 @@
 // Convenience function to get the delta in seconds between two timevals
 float get_delta_seconds(struct timeval tv1, struct timeval tv2);
 
+// Saves the best solution found so far, with the trace of improvements.
+// The file is replaced atomically, so it always holds a complete result.
+void save_best_so_far(const char *file, const rundata *run, const solution *sol);
+
 // Saves the results of an execution, with the problem information and
 // the resulting solutions
 void save_solutions(const char *file,
@@ -17,5 +21,9 @@ void save_solutions(const char *file,
         const char *input_file, float seconds, float elapsed, int mem_usage,
         const redstrategy *strategies, int n_strategies, int only_1_output_sol);
 
+// Appends the PROFILE and PERF COUNTERS INFO sections of the profiler (stdout if file is NULL),
+// after the output was saved so that its phase is included
+void save_profile(const char *file, const rundata *run);
+
 
 #endif
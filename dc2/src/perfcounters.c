@@ -0,0 +1,134 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
+
+const char *perfcounter_names[] = {
+    "CYCLES",
+    "INSTRUCTIONS",
+    "LLC_MISSES",
+    "BRANCH_MISSES",
+};
+
+#ifdef __linux__
+// Opens a hardware counter of the current process that is inherited by the threads created after it
+int perfcounter_open(unsigned long long config){
+    struct perf_event_attr attr;
+    memset(&attr,0,sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // To scale the counts when the counters are multiplexed
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+    int fd = syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+    // A failure is not an error, errno must be clean for the next allocations
+    if(fd<0) errno = 0;
+    return fd;
+}
+#endif
+
+perfcounters *perfcounters_init(int n_phases){
+    #ifdef __linux__
+        const unsigned long long configs[N_PERFCOUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+        };
+        int fd[N_PERFCOUNTERS];
+        int n_available = 0;
+        for(int k=0;k<N_PERFCOUNTERS;k++){
+            fd[k] = perfcounter_open(configs[k]);
+            if(fd[k]>=0) n_available += 1;
+        }
+        if(n_available==0) return NULL;
+        perfcounters *perf = safe_malloc(sizeof(perfcounters));
+        perf->n_phases = n_phases;
+        for(int k=0;k<N_PERFCOUNTERS;k++) perf->fd[k] = fd[k];
+        perf->begin = safe_malloc(sizeof(uint64_t)*n_phases*N_PERFCOUNTERS);
+        perf->total = safe_malloc(sizeof(uint64_t)*n_phases*N_PERFCOUNTERS);
+        perf->n_measures = safe_malloc(sizeof(long long)*n_phases);
+        memset(perf->begin,0,sizeof(uint64_t)*n_phases*N_PERFCOUNTERS);
+        memset(perf->total,0,sizeof(uint64_t)*n_phases*N_PERFCOUNTERS);
+        memset(perf->n_measures,0,sizeof(long long)*n_phases);
+        return perf;
+    #else
+        return NULL;
+    #endif
+}
+
+void perfcounters_free(perfcounters *perf){
+    #ifdef __linux__
+        for(int k=0;k<N_PERFCOUNTERS;k++){
+            if(perf->fd[k]>=0) close(perf->fd[k]);
+        }
+    #endif
+    free(perf->begin);
+    free(perf->total);
+    free(perf->n_measures);
+    free(perf);
+}
+
+void perfcounters_read(const perfcounters *perf, uint64_t *vals){
+    for(int k=0;k<N_PERFCOUNTERS;k++){
+        vals[k] = 0;
+        #ifdef __linux__
+            if(perf->fd[k]<0) continue;
+            // value, time enabled, time running
+            uint64_t data[3];
+            if(read(perf->fd[k],data,sizeof(data))!=sizeof(data)){
+                errno = 0;
+                continue;
+            }
+            if(data[2]>0 && data[2]<data[1]){
+                vals[k] = (uint64_t)((double)data[0]*((double)data[1]/(double)data[2]));
+            }else{
+                vals[k] = data[0];
+            }
+        #endif
+    }
+}
+
+void perfcounters_begin(perfcounters *perf, int phase){
+    if(perf==NULL) return;
+    perfcounters_read(perf,&perf->begin[phase*N_PERFCOUNTERS]);
+}
+
+void perfcounters_end(perfcounters *perf, int phase){
+    if(perf==NULL) return;
+    uint64_t vals[N_PERFCOUNTERS];
+    perfcounters_read(perf,vals);
+    for(int k=0;k<N_PERFCOUNTERS;k++){
+        uint64_t begin = perf->begin[phase*N_PERFCOUNTERS+k];
+        if(vals[k]>begin) perf->total[phase*N_PERFCOUNTERS+k] += vals[k]-begin;
+    }
+    perf->n_measures[phase] += 1;
+}
+
+void perfcounters_print(const perfcounters *perf, const char **phase_names, FILE *fp){
+    fprintf(fp,"== PERF COUNTERS INFO ==\n");
+    fprintf(fp,"# PERFC %-16s","PHASE");
+    for(int k=0;k<N_PERFCOUNTERS;k++){
+        fprintf(fp," %16s",perf->fd[k]>=0? perfcounter_names[k] : "(N/A)");
+    }
+    fprintf(fp," %8s %12s %12s\n","IPC","LLC_MPKI","BRANCH_MPKI");
+    for(int i=0;i<perf->n_phases;i++){
+        if(perf->n_measures[i]==0) continue;
+        const uint64_t *tot = &perf->total[i*N_PERFCOUNTERS];
+        fprintf(fp,"# PERFC %-16s",phase_names[i]);
+        for(int k=0;k<N_PERFCOUNTERS;k++){
+            fprintf(fp," %16llu",(unsigned long long)tot[k]);
+        }
+        double instrs = (double)tot[PERFC_INSTRUCTIONS];
+        double ipc = tot[PERFC_CYCLES]>0? instrs/(double)tot[PERFC_CYCLES] : 0;
+        double llc_mpki = instrs>0? 1000.0*tot[PERFC_LLC_MISSES]/instrs : 0;
+        double branch_mpki = instrs>0? 1000.0*tot[PERFC_BRANCH_MISSES]/instrs : 0;
+        fprintf(fp," %8.4f %12.4f %12.4f\n",ipc,llc_mpki,branch_mpki);
+    }
+}
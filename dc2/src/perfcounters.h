@@ -0,0 +1,45 @@
+#ifndef DC_PERFCOUNTERS_H
+#define DC_PERFCOUNTERS_H
+
+#include "utils.h"
+
+// Hardware counters measured
+typedef enum {
+    PERFC_CYCLES        = 0,
+    PERFC_INSTRUCTIONS  = 1,
+    PERFC_LLC_MISSES    = 2,
+    PERFC_BRANCH_MISSES = 3,
+} perfcounter;
+
+#define N_PERFCOUNTERS 4
+
+// Hardware counters of the process (including the threads it creates), accumulated per phase.
+// A phase must begin and end on the same thread, and phases of the same kind can't overlap.
+typedef struct {
+    int n_phases;
+    // | File descriptor of each counter (-1 if it is not available)
+    int fd[N_PERFCOUNTERS];
+    // | Value of the counters when each phase began
+    uint64_t *begin;
+    // | Accumulated counts of each phase
+    uint64_t *total;
+    long long *n_measures;
+} perfcounters;
+
+// Opens the counters with perf_event_open, returns NULL if none is available
+perfcounters *perfcounters_init(int n_phases);
+
+// Close the counters and free memory
+void perfcounters_free(perfcounters *perf);
+
+// Reads the current value of the counters
+void perfcounters_read(const perfcounters *perf, uint64_t *vals);
+
+// Marks the beginning and end of a phase, the difference is accumulated on the phase
+void perfcounters_begin(perfcounters *perf, int phase);
+void perfcounters_end(perfcounters *perf, int phase);
+
+// Prints the counts of each phase, with the derived IPC and misses per thousand instructions
+void perfcounters_print(const perfcounters *perf, const char **phase_names, FILE *fp);
+
+#endif
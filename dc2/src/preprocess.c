@@ -0,0 +1,241 @@
+#include "preprocess.h"
+
+#define FAC_FREE 0
+#define FAC_OPEN 1
+#define FAC_CLOSED (-1)
+
+// Fixes facilities open and closed until no rule applies. Based on the rules of Goldengorin et al. (2003):
+// - If the cost of a facility is not larger than the increase of the assignment costs when it is removed from
+//   the set of all the facilities that are not closed, then there is an optimal solution with it open.
+// - If the cost of a facility is not smaller than the decrease of the assignment costs when it is added to the
+//   set of open facilities, then there is an optimal solution without it.
+void preprocessing_fix_facilities(const problem *prob, int *state){
+    int n = prob->n_clis;
+    int m = prob->n_facs;
+    int *phi1 = safe_malloc(sizeof(int)*n);
+    double *c1 = safe_malloc(sizeof(double)*n);
+    double *c2 = safe_malloc(sizeof(double)*n);
+    double *dopen = safe_malloc(sizeof(double)*n);
+    double *delta = safe_malloc(sizeof(double)*m);
+    int changed = 1;
+    while(changed){
+        changed = 0;
+        // 1st and 2nd nearest facilities that are not closed, and nearest open facility, for each client
+        for(int j=0;j<n;j++){
+            phi1[j] = -1;
+            c1[j] = INFINITY;
+            c2[j] = INFINITY;
+            dopen[j] = INFINITY;
+            for(int i=0;i<m;i++){
+                if(state[i]==FAC_CLOSED) continue;
+                double c = problem_assig_cost(prob,i,j);
+                if(state[i]==FAC_OPEN && c<dopen[j]) dopen[j] = c;
+                if(c<c1[j]){
+                    c2[j] = c1[j];
+                    c1[j] = c;
+                    phi1[j] = i;
+                }else if(c<c2[j]){
+                    c2[j] = c;
+                }
+            }
+        }
+        // Open rule
+        for(int i=0;i<m;i++) delta[i] = 0;
+        for(int j=0;j<n;j++){
+            if(phi1[j]!=-1) delta[phi1[j]] += c2[j]-c1[j];
+        }
+        for(int i=0;i<m;i++){
+            if(state[i]==FAC_FREE && prob->facility_cost[i]<=delta[i]){
+                state[i] = FAC_OPEN;
+                changed = 1;
+            }
+        }
+        if(changed) continue;
+        // Close rule
+        for(int i=0;i<m;i++){
+            if(state[i]!=FAC_FREE) continue;
+            double gain = 0;
+            for(int j=0;j<n && gain<prob->facility_cost[i];j++){
+                double c = problem_assig_cost(prob,i,j);
+                if(c<dopen[j]) gain += dopen[j]-c;
+            }
+            if(prob->facility_cost[i]>=gain){
+                state[i] = FAC_CLOSED;
+                changed = 1;
+            }
+        }
+    }
+    free(delta);
+    free(dopen);
+    free(c2);
+    free(c1);
+    free(phi1);
+}
+
+// Hash of the cost column of a client on the reduced facilities
+uint64_t column_hash(const double *col, int len){
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(int k=0;k<len;k++){
+        uint64_t bits;
+        memcpy(&bits,&col[k],sizeof(uint64_t));
+        h = (h^bits)*0x100000001b3ULL;
+    }
+    return h;
+}
+
+typedef struct {
+    uint64_t hash;
+    int cli;
+    const double *col;
+    int len;
+} clicolumn;
+
+int clicolumn_cmp(const void *a, const void *b){
+    const clicolumn *aa = (const clicolumn *) a;
+    const clicolumn *bb = (const clicolumn *) b;
+    if(aa->hash!=bb->hash) return aa->hash<bb->hash? -1 : +1;
+    int d = memcmp(aa->col,bb->col,sizeof(double)*aa->len);
+    if(d!=0) return d;
+    return aa->cli - bb->cli;
+}
+
+int preprocessing_is_trivial(const preprocessing *pre){
+    return pre->n_fixed==0 && pre->n_closed==0 && pre->n_merged==0 && pre->prob->n_facs==pre->orig->n_facs;
+}
+
+preprocessing *preprocessing_init(const problem *prob, int fix_facilities, int verbose){
+    int n = prob->n_clis;
+    int m = prob->n_facs;
+    preprocessing *pre = safe_malloc(sizeof(preprocessing));
+    pre->orig = prob;
+    pre->n_fixed = 0;
+    pre->fixed = safe_malloc(sizeof(int)*(m+1));
+    pre->facs_map = safe_malloc(sizeof(int)*(m+1));
+    pre->n_closed = 0;
+
+    // Fix facilities, only when there are no size restrictions
+    int *state = safe_malloc(sizeof(int)*(m+1));
+    for(int i=0;i<m;i++) state[i] = FAC_FREE;
+    if(fix_facilities && prob->size_restriction_minimum==-1 && prob->size_restriction_maximum==-1){
+        preprocessing_fix_facilities(prob,state);
+    }
+    int n_free = 0;
+    for(int i=0;i<m;i++){
+        if(state[i]==FAC_FREE) pre->facs_map[n_free++] = i;
+        else if(state[i]==FAC_OPEN) pre->fixed[pre->n_fixed++] = i;
+        else pre->n_closed++;
+    }
+    // At least one facility is left for the search
+    if(n_free==0 && pre->n_fixed>0){
+        pre->n_fixed--;
+        pre->facs_map[n_free++] = pre->fixed[pre->n_fixed];
+    }
+    free(state);
+
+    // Cost column of each client on the remaining facilities, the last element is the cost to the fixed ones
+    double *cols = safe_malloc(sizeof(double)*n*(n_free+1)+1);
+    double fixed_cost = 0;
+    for(int k=0;k<pre->n_fixed;k++) fixed_cost += prob->facility_cost[pre->fixed[k]];
+    for(int j=0;j<n;j++){
+        double *col = &cols[j*(n_free+1)];
+        for(int k=0;k<n_free;k++) col[k] = problem_assig_cost(prob,pre->facs_map[k],j);
+        col[n_free] = problem_assig_cost(prob,-1,j);
+        for(int k=0;k<pre->n_fixed;k++){
+            double c = problem_assig_cost(prob,pre->fixed[k],j);
+            if(c<col[n_free]) col[n_free] = c;
+        }
+    }
+    // Merge clients with the same column
+    clicolumn *ccols = safe_malloc(sizeof(clicolumn)*(n+1));
+    for(int j=0;j<n;j++){
+        ccols[j].cli = j;
+        ccols[j].col = &cols[j*(n_free+1)];
+        ccols[j].len = n_free+1;
+        ccols[j].hash = column_hash(ccols[j].col,ccols[j].len);
+    }
+    qsort(ccols,n,sizeof(clicolumn),clicolumn_cmp);
+    int *group_start = safe_malloc(sizeof(int)*(n+1));
+    int n_groups = 0;
+    for(int r=0;r<n;r++){
+        if(r==0 || ccols[r].hash!=ccols[r-1].hash ||
+                memcmp(ccols[r].col,ccols[r-1].col,sizeof(double)*(n_free+1))!=0){
+            group_start[n_groups++] = r;
+        }
+    }
+    group_start[n_groups] = n;
+    // Keep the groups in the order of their first client, like the clients of the original problem.
+    // The first client of each group is the smallest one, as ties are sorted by client.
+    int *group_of_first = safe_malloc(sizeof(int)*(n+1));
+    for(int j=0;j<n;j++) group_of_first[j] = -1;
+    for(int g=0;g<n_groups;g++) group_of_first[ccols[group_start[g]].cli] = g;
+    int *group_order = safe_malloc(sizeof(int)*(n_groups+1));
+    int n_ordered = 0;
+    for(int j=0;j<n;j++){
+        if(group_of_first[j]!=-1) group_order[n_ordered++] = group_of_first[j];
+    }
+    assert(n_ordered==n_groups);
+    free(group_of_first);
+
+    // Create the reduced problem. The number of merged clients multiplies their costs, and the cost of the
+    // fixed facilities is distributed between the clients, so the values of the solutions are kept.
+    pre->n_merged = n-n_groups;
+    pre->prob = problem_init(n_free,n_groups);
+    for(int k=0;k<n_free;k++) pre->prob->facility_cost[k] = prob->facility_cost[pre->facs_map[k]];
+    double shift = n_groups>0? fixed_cost/n_groups : 0;
+    for(int j=0;j<n_groups;j++){
+        int g = group_order[j];
+        int weight = group_start[g+1]-group_start[g];
+        const double *col = ccols[group_start[g]].col;
+        pre->prob->client_weight[j] = 0;
+        for(int r=group_start[g];r<group_start[g+1];r++){
+            pre->prob->client_weight[j] += prob->client_weight[ccols[r].cli];
+        }
+        for(int k=-1;k<n_free;k++){
+            double c = k==-1? col[n_free] : col[k];
+            pre->prob->distance_cost[k][j] = weight*c + shift;
+        }
+    }
+    pre->prob->size_restriction_minimum = prob->size_restriction_minimum;
+    pre->prob->size_restriction_maximum = prob->size_restriction_maximum;
+    free(group_order);
+    free(group_start);
+    free(ccols);
+    free(cols);
+
+    if(verbose && !preprocessing_is_trivial(pre)){
+        printf("\nPreprocessing: %d facilities fixed open, %d closed, %d clients merged.\n",
+            pre->n_fixed,pre->n_closed,pre->n_merged);
+        printf("Reduced problem: %d facilities, %d clients.\n",pre->prob->n_facs,pre->prob->n_clis);
+    }
+    return pre;
+}
+
+void preprocessing_free(preprocessing *pre){
+    problem_free(pre->prob);
+    free(pre->facs_map);
+    free(pre->fixed);
+    free(pre);
+}
+
+solution *preprocessing_map_solution(const preprocessing *pre, const solution *sol){
+    solution *orig_sol = solution_empty(pre->orig);
+    for(int k=0;k<pre->n_fixed;k++) solution_add(pre->orig,orig_sol,pre->fixed[k],NULL);
+    for(int k=0;k<sol->n_facs;k++) solution_add(pre->orig,orig_sol,pre->facs_map[sol->facs[k]],NULL);
+    orig_sol->terminal = sol->terminal;
+    return orig_sol;
+}
+
+solution *preprocessing_reduce_solution(const preprocessing *pre, const solution *orig_sol){
+    // Facility of the reduced problem for each facility of the original one (-1 if fixed or closed)
+    int *inv_map = safe_malloc(sizeof(int)*(pre->orig->n_facs+1));
+    for(int i=0;i<pre->orig->n_facs;i++) inv_map[i] = -1;
+    for(int k=0;k<pre->prob->n_facs;k++) inv_map[pre->facs_map[k]] = k;
+    solution *sol = solution_empty(pre->prob);
+    for(int k=0;k<orig_sol->n_facs;k++){
+        int f = inv_map[orig_sol->facs[k]];
+        if(f!=-1) solution_add(pre->prob,sol,f,NULL);
+    }
+    sol->terminal = orig_sol->terminal;
+    free(inv_map);
+    return sol;
+}
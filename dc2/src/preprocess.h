@@ -0,0 +1,47 @@
+#ifndef DC_PREPROCESS_H
+#define DC_PREPROCESS_H
+
+#include "utils.h"
+#include "problem.h"
+#include "solution.h"
+
+// Reduction of a problem before the search: facilities that are proven to be closed on an optimal solution are
+// dropped, the ones proven to be open are fixed, and clients with the same costs are merged.
+// The fixed facilities are represented by the unassigned cost (row -1) of the reduced problem, so the solutions
+// of the reduced problem don't include them. The value of a solution of the reduced problem is the same as
+// the one of the solution of the original problem, including the fixed facilities.
+// (preprocessing is declared on rundata.h)
+struct preprocessing {
+    // | The original problem (not owned)
+    const problem *orig;
+    // | The reduced problem
+    problem *prob;
+    // | Facility of the original problem for each facility of the reduced one
+    int *facs_map;
+    // | Facilities of the original problem that are fixed open
+    int n_fixed;
+    int *fixed;
+    // | Number of facilities of the original problem that were closed
+    int n_closed;
+    // | Number of clients of the original problem that were merged with another one
+    int n_merged;
+};
+
+// Reduces the given problem. Clients with the same costs are always merged, the merged client has the sum of their
+// weights. Facilities are fixed only if fix_facilities and the problem has no size restrictions.
+// The given problem is not copied, so it must outlive the preprocessing.
+preprocessing *preprocessing_init(const problem *prob, int fix_facilities, int verbose);
+
+// If the reduced problem is the same as the original one
+int preprocessing_is_trivial(const preprocessing *pre);
+
+void preprocessing_free(preprocessing *pre);
+
+// Retrieves the solution of the original problem that corresponds to a solution of the reduced one
+solution *preprocessing_map_solution(const preprocessing *pre, const solution *sol);
+
+// Retrieves the solution of the reduced problem that is closest to a solution of the original one:
+// its fixed facilities are implicit and its closed facilities are dropped.
+solution *preprocessing_reduce_solution(const preprocessing *pre, const solution *orig_sol);
+
+#endif
@@ -7,6 +7,8 @@ problem *problem_init(int n_facs, int n_clis){
     //
     prob->facility_cost = safe_malloc(sizeof(double)*prob->n_facs);
     memset(prob->facility_cost,0,     sizeof(double)*prob->n_facs);
+    prob->client_weight = safe_malloc(sizeof(double)*prob->n_clis);
+    for(int j=0;j<prob->n_clis;j++) prob->client_weight[j] = 1;
     // Initialize distance cost matrix with rows starting from -1
     prob->distance_cost = safe_malloc(sizeof(double*)*(prob->n_facs+1));
     prob->distance_cost += 1;
@@ -21,6 +23,33 @@ problem *problem_init(int n_facs, int n_clis){
 
     prob->size_restriction_minimum = -1;
     prob->size_restriction_maximum = -1;
+    prob->borrowed = 0;
+    prob->clis_capacity = n_clis;
+
+    return prob;
+}
+
+problem *problem_wrap(int n_facs, int n_clis, double *facility_cost, double *costs){
+    problem *prob = safe_malloc(sizeof(problem));
+    prob->n_facs = n_facs;
+    prob->n_clis = n_clis;
+    //
+    prob->facility_cost = facility_cost;
+    prob->client_weight = safe_malloc(sizeof(double)*prob->n_clis);
+    for(int j=0;j<prob->n_clis;j++) prob->client_weight[j] = 1;
+    // Rows starting from -1, row -1 is the only one that is allocated
+    prob->distance_cost = safe_malloc(sizeof(double*)*(prob->n_facs+1));
+    prob->distance_cost += 1;
+    prob->distance_cost[-1] = safe_malloc(sizeof(double)*prob->n_clis);
+    for(int j=0;j<prob->n_clis;j++) prob->distance_cost[-1][j] = INFINITY;
+    for(int i=0;i<prob->n_facs;i++){
+        prob->distance_cost[i] = &costs[(size_t)i*prob->n_clis];
+    }
+
+    prob->size_restriction_minimum = -1;
+    prob->size_restriction_maximum = -1;
+    prob->borrowed = 1;
+    prob->clis_capacity = n_clis;
 
     return prob;
 }
@@ -32,8 +61,9 @@ problem *problem_copy(const problem *other){
     prob->size_restriction_maximum = other->size_restriction_maximum;
     //
     memcpy(prob->facility_cost,other->facility_cost,sizeof(double)*prob->n_facs);
-    //
-    for(int i=0;i<prob->n_facs;i++){
+    memcpy(prob->client_weight,other->client_weight,sizeof(double)*prob->n_clis);
+    // Row -1 is also copied, as it may not be the default one
+    for(int i=-1;i<prob->n_facs;i++){
         for(int j=0;j<prob->n_clis;j++){
             prob->distance_cost[i][j] = other->distance_cost[i][j];
         }
@@ -41,14 +71,49 @@ problem *problem_copy(const problem *other){
     return prob;
 }
 
+void problem_set_client_costs(problem *prob, int c, const double *costs){
+    assert(!prob->borrowed && 0<=c && c<prob->n_clis);
+    for(int i=0;i<prob->n_facs;i++) prob->distance_cost[i][c] = costs[i];
+}
+
+int problem_add_client(problem *prob, const double *costs){
+    assert(!prob->borrowed);
+    // Grow the arrays when they are full
+    if(prob->n_clis==prob->clis_capacity){
+        prob->clis_capacity = 2*prob->clis_capacity+1;
+        prob->client_weight = safe_realloc(prob->client_weight,sizeof(double)*prob->clis_capacity);
+        for(int i=-1;i<prob->n_facs;i++){
+            prob->distance_cost[i] = safe_realloc(prob->distance_cost[i],sizeof(double)*prob->clis_capacity);
+        }
+    }
+    int c = prob->n_clis;
+    prob->n_clis += 1;
+    prob->client_weight[c] = 1;
+    prob->distance_cost[-1][c] = INFINITY;
+    problem_set_client_costs(prob,c,costs);
+    return c;
+}
+
+void problem_remove_client(problem *prob, int c){
+    assert(!prob->borrowed && 0<=c && c<prob->n_clis);
+    int last = prob->n_clis-1;
+    prob->client_weight[c] = prob->client_weight[last];
+    for(int i=-1;i<prob->n_facs;i++) prob->distance_cost[i][c] = prob->distance_cost[i][last];
+    prob->n_clis -= 1;
+}
+
 void problem_free(problem *prob){
     // Free facility-client distances
-    for(int i=-1;i<prob->n_facs;i++){
-        free(prob->distance_cost[i]);
+    free(prob->distance_cost[-1]);
+    if(!prob->borrowed){
+        for(int i=0;i<prob->n_facs;i++){
+            free(prob->distance_cost[i]);
+        }
     }
     free(prob->distance_cost-1);
     // Free per facility and client arrays
-    free(prob->facility_cost);
+    if(!prob->borrowed) free(prob->facility_cost);
+    free(prob->client_weight);
     // Free problem
     free(prob);
 }
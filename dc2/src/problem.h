@@ -11,10 +11,18 @@ typedef struct {
     double *facility_cost;
     // | Cost matrix between facilities and clients.
     double **distance_cost;
+    // | Weight of each client, the number of original clients that it represents.
+    // The costs of distance_cost are already multiplied by it, so values don't need to consider it.
+    double *client_weight;
     // | Unless it is -1, the solutions retrieved must be of this size or larger.
     int size_restriction_minimum;
     // | Unless it is -1, the solutions retrieved must be of this size or smaller.
     int size_restriction_maximum;
+    // | If facility_cost and the rows of distance_cost (except row -1) belong to the caller of problem_wrap,
+    // so they are not freed with the problem.
+    int borrowed;
+    // | Number of clients that fit on the arrays, so clients can be added.
+    int clis_capacity;
 } problem;
 
 // | Retrieves the cost of assigning the client c to the facility f
@@ -29,9 +37,22 @@ static inline double problem_assig_value(const problem *prob, int f, int c){
 // Initializes a problem along with all the needed arrays.
 problem *problem_init(int n_facs, int n_clis);
 
+// Initializes a problem over the given arrays, without copying them. costs has the costs of assigning each client
+// to the first facility, then the ones of the second facility, and so on. The arrays must outlive the problem.
+problem *problem_wrap(int n_facs, int n_clis, double *facility_cost, double *costs);
+
 // Initializes a problem copying data from another one.
 problem *problem_copy(const problem *other);
 
+// Changes the costs of assigning the client c to each facility (n_facs costs).
+void problem_set_client_costs(problem *prob, int c, const double *costs);
+
+// Adds a client with the given costs for each facility (n_facs costs) and weight 1, retrieving its index.
+int problem_add_client(problem *prob, const double *costs);
+
+// Removes the client c, the last client takes its index.
+void problem_remove_client(problem *prob, int c);
+
 // Free a problem memory
 void problem_free(problem *prob);
 
@@ -0,0 +1,144 @@
+#include "profiler.h"
+
+#define PROFRING_INITIAL_CAPACITY 64
+#define PROFRING_MAX_CAPACITY (1<<16)
+
+const char *profphase_names[] = {
+    "LOAD",
+    "PREPROCESS",
+    "PRECOMP",
+    "EXPAND",
+    "FILTER",
+    "REDUCTION",
+    "LOCAL_SEARCH",
+    "PATH_RELINKING",
+    "OUTPUT",
+};
+
+profiler *profiler_init(int n_sets, int n_threads, int hw_counters){
+    profiler *prof = safe_malloc(sizeof(profiler));
+    clock_gettime(CLOCK_MONOTONIC,&prof->start);
+    prof->n_sets = n_sets;
+    prof->n_tids = n_threads+1;
+    // The spans of a ring are allocated when it records the first one
+    prof->rings = safe_malloc(sizeof(profring)*prof->n_sets*prof->n_tids);
+    for(int i=0;i<prof->n_sets*prof->n_tids;i++){
+        prof->rings[i].spans = NULL;
+        prof->rings[i].capacity = 0;
+        prof->rings[i].n_spans = 0;
+    }
+    for(int i=0;i<N_PROFPHASES;i++) prof->added_ns[i] = 0;
+    prof->perf = hw_counters? perfcounters_init(N_PROFPHASES) : NULL;
+    return prof;
+}
+
+void profiler_free(profiler *prof){
+    for(int i=0;i<prof->n_sets*prof->n_tids;i++) free(prof->rings[i].spans);
+    free(prof->rings);
+    if(prof->perf!=NULL) perfcounters_free(prof->perf);
+    free(prof);
+}
+
+uint64_t profiler_now(const profiler *prof){
+    if(prof==NULL) return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (uint64_t)(now.tv_sec-prof->start.tv_sec)*1000000000ULL + now.tv_nsec - prof->start.tv_nsec;
+}
+
+uint64_t profiler_begin(profiler *prof, profphase phase){
+    if(prof==NULL) return 0;
+    perfcounters_begin(prof->perf,phase);
+    return profiler_now(prof);
+}
+
+void profiler_span(profiler *prof, profphase phase, uint64_t start, int set, int tid, int generation, const char *label){
+    if(prof==NULL) return;
+    uint64_t end = profiler_now(prof);
+    // The spans of the coordinating thread are the ones that began with profiler_begin
+    if(tid==0) perfcounters_end(prof->perf,phase);
+    // Only one thread at a time has a given logical thread, so the ring isn't locked
+    assert(set>=0 && set<prof->n_sets);
+    assert(tid>=0 && tid<prof->n_tids);
+    profring *ring = &prof->rings[set*prof->n_tids+tid];
+    if(ring->spans==NULL){
+        ring->capacity = PROFRING_INITIAL_CAPACITY;
+        ring->spans = safe_malloc(sizeof(profspan)*ring->capacity);
+    }
+    // Grow the ring until its maximum capacity, then overwrite
+    if(ring->n_spans==ring->capacity && ring->capacity<PROFRING_MAX_CAPACITY){
+        ring->capacity *= 2;
+        ring->spans = safe_realloc(ring->spans,sizeof(profspan)*ring->capacity);
+    }
+    profspan *span = &ring->spans[ring->n_spans%ring->capacity];
+    span->start = start;
+    span->end = end;
+    span->label = label;
+    span->generation = generation;
+    span->phase = phase;
+    span->tid = tid;
+    ring->n_spans += 1;
+}
+
+void profiler_add(profiler *prof, profphase phase, uint64_t ns){
+    if(prof==NULL) return;
+    __atomic_fetch_add(&prof->added_ns[phase],ns,__ATOMIC_RELAXED);
+}
+
+// Number of spans still kept on a ring
+static inline int profring_len(const profring *ring){
+    return ring->n_spans<ring->capacity? (int)ring->n_spans : ring->capacity;
+}
+
+void profiler_save_trace(const profiler *prof, const char *fname){
+    FILE *fp = fopen(fname,"w");
+    if(fp==NULL){
+        fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",fname);
+        exit(1);
+    }
+    fprintf(fp,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int first = 1;
+    for(int i=0;i<prof->n_sets*prof->n_tids;i++){
+        const profring *ring = &prof->rings[i];
+        int len = profring_len(ring);
+        for(int k=0;k<len;k++){
+            const profspan *span = &ring->spans[k];
+            // Each set is shown as a process
+            fprintf(fp,"%s{\"name\":\"%s\",\"cat\":\"dc2\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"generation\":%d",
+                first? "" : ",\n",profphase_names[span->phase],i/prof->n_tids,span->tid,
+                1e-3*span->start,1e-3*(span->end-span->start),span->generation);
+            if(span->label!=NULL) fprintf(fp,",\"label\":\"%s\"",span->label);
+            fprintf(fp,"}}");
+            first = 0;
+        }
+    }
+    fprintf(fp,"\n]}\n");
+    fclose(fp);
+}
+
+void profiler_print_summary(const profiler *prof, int n_threads, FILE *fp){
+    long long n_spans[N_PROFPHASES] = {0};
+    double wall[N_PROFPHASES] = {0};
+    double worker[N_PROFPHASES] = {0};
+    long long n_lost = 0;
+    for(int i=0;i<prof->n_sets*prof->n_tids;i++){
+        const profring *ring = &prof->rings[i];
+        int len = profring_len(ring);
+        n_lost += ring->n_spans-len;
+        for(int k=0;k<len;k++){
+            const profspan *span = &ring->spans[k];
+            double secs = 1e-9*(span->end-span->start);
+            n_spans[span->phase] += 1;
+            if(span->tid==0) wall[span->phase] += secs;
+            else worker[span->phase] += secs;
+        }
+    }
+    fprintf(fp,"== PROFILE ==\n");
+    fprintf(fp,"# PROFILE_LOST_SPANS: %lld\n",n_lost);
+    fprintf(fp,"# PROF %-16s %10s %12s %12s %10s\n","PHASE","SPANS","WALL_SECS","WORKER_SECS","EFFICIENCY");
+    for(int i=0;i<N_PROFPHASES;i++){
+        double work = worker[i]+1e-9*prof->added_ns[i];
+        double efficiency = (wall[i]>0 && work>0)? work/(wall[i]*n_threads) : 0;
+        fprintf(fp,"# PROF %-16s %10lld %12.6f %12.6f %10.4f\n",profphase_names[i],n_spans[i],wall[i],work,efficiency);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef DC_PROFILER_H
+#define DC_PROFILER_H
+
+#include "utils.h"
+#include "perfcounters.h"
+
+#include <time.h>
+
+// Phases of the algorithm that are measured
+typedef enum {
+    PHASE_LOAD           = 0,
+    PHASE_PREPROCESS     = 1,
+    PHASE_PRECOMP        = 2,
+    PHASE_EXPAND         = 3,
+    PHASE_FILTER         = 4,
+    PHASE_REDUCTION      = 5,
+    PHASE_LOCAL_SEARCH   = 6,
+    PHASE_PATH_RELINKING = 7,
+    PHASE_OUTPUT         = 8,
+} profphase;
+
+#define N_PROFPHASES 9
+
+// A measured interval of a phase, in nanoseconds since the start of the profiler
+typedef struct {
+    uint64_t start, end;
+    const char *label;
+    int generation;
+    short phase;
+    // Logical thread: 0 for the thread that coordinates the phases, 1+i for the i-th worker thread
+    short tid;
+} profspan;
+
+// Spans recorded by a logical thread, the oldest ones are overwritten when it is full.
+// Worker threads are created on each call, so the rings belong to the logical threads rather than to the OS ones.
+typedef struct {
+    profspan *spans;
+    int capacity;
+    long long n_spans; // total, including the overwritten ones
+} profring;
+
+// (also declared on rundata.h)
+typedef struct profiler profiler;
+
+struct profiler {
+    struct timespec start;
+    // | Ring of each logical thread of each set (n_sets*n_tids), a set for each restart worker with -p
+    profring *rings;
+    int n_sets;
+    int n_tids;
+    // | Time of the phases that is accumulated without spans (for short intervals inside the workers)
+    uint64_t added_ns[N_PROFPHASES];
+    // | Hardware counters of the phases, measured on the spans of the coordinating thread (NULL if disabled)
+    perfcounters *perf;
+};
+
+extern const char *profphase_names[];
+
+// Profiler initialization for n_sets sets of n_threads+1 logical threads,
+// hw_counters to also measure hardware counters (when available)
+profiler *profiler_init(int n_sets, int n_threads, int hw_counters);
+
+// Free profiler
+void profiler_free(profiler *prof);
+
+// Nanoseconds since the start of the profiler (0 if prof is NULL)
+uint64_t profiler_now(const profiler *prof);
+
+// Marks the beginning of a phase on the coordinating thread, returns profiler_now
+uint64_t profiler_begin(profiler *prof, profphase phase);
+
+// Records a span of a phase that started at the given moment and ends now, on the ring of the logical thread tid
+// of the given set (see rundata prof_set); does nothing if prof is NULL
+void profiler_span(profiler *prof, profphase phase, uint64_t start, int set, int tid, int generation, const char *label);
+
+// Adds time to a phase without recording a span (thread safe)
+void profiler_add(profiler *prof, profphase phase, uint64_t ns);
+
+// Saves the spans as Chrome trace-event JSON (chrome://tracing, Perfetto)
+void profiler_save_trace(const profiler *prof, const char *fname);
+
+// Prints a table with the wall time of each phase, the time spent by the workers and the parallel efficiency
+void profiler_print_summary(const profiler *prof, int n_threads, FILE *fp);
+
+#endif
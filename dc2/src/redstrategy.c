@@ -2,21 +2,18 @@
 
 const char *default_redstrategies[] = {"rand1:3000","sdbs+:100:pcd","_best:200"};
 
-redstrategy *redstrategy_init_from_nomenclatures(const char **noms, int *n_noms){
+redstrategy *redstrategy_parse_nomenclatures(const char **noms, int *n_noms, char *error){
     int n_strategies = *n_noms;
-    redstrategy *strategies;
     if(n_strategies==0){
         // Default strategies
+        noms = default_redstrategies;
         n_strategies = sizeof(default_redstrategies)/sizeof(default_redstrategies[0]);
-        strategies = safe_malloc(sizeof(redstrategy)*n_strategies);
-        for(int i=0;i<n_strategies;i++){
-            strategies[i] = redstrategy_from_nomenclature(default_redstrategies[i]);
-        }
-    }else{
-        // Strategies from arguments
-        strategies = safe_malloc(sizeof(redstrategy)*n_strategies);
-        for(int i=0;i<n_strategies;i++){
-            strategies[i] = redstrategy_from_nomenclature(noms[i]);
+    }
+    redstrategy *strategies = safe_malloc(sizeof(redstrategy)*n_strategies);
+    for(int i=0;i<n_strategies;i++){
+        if(!redstrategy_parse(noms[i],&strategies[i],error)){
+            free(strategies);
+            return NULL;
         }
     }
     // Check that strategy n_targets are decreasing
@@ -25,8 +22,9 @@ redstrategy *redstrategy_init_from_nomenclatures(const char **noms, int *n_noms)
         for(int i=0;i<n_strategies;i++){
             if(strategies[i].for_selected_sols == t){
                 if(strategies[i].n_target>=current_n_target){
-                    fprintf(stderr,"ERROR: strategy n_targets must decrease!\n");
-                    exit(1);
+                    snprintf(error,REDSTRATEGY_ERROR_LEN,"strategy n_targets must decrease!");
+                    free(strategies);
+                    return NULL;
                 }
                 current_n_target = strategies[i].n_target;
             }
@@ -37,7 +35,27 @@ redstrategy *redstrategy_init_from_nomenclatures(const char **noms, int *n_noms)
     return strategies;
 }
 
+redstrategy *redstrategy_init_from_nomenclatures(const char **noms, int *n_noms){
+    char error[REDSTRATEGY_ERROR_LEN];
+    redstrategy *strategies = redstrategy_parse_nomenclatures(noms,n_noms,error);
+    if(strategies==NULL){
+        fprintf(stderr,"ERROR: %s\n",error);
+        exit(1);
+    }
+    return strategies;
+}
+
 redstrategy redstrategy_from_nomenclature(const char *nomenclature){
+    char error[REDSTRATEGY_ERROR_LEN];
+    redstrategy strategy;
+    if(!redstrategy_parse(nomenclature,&strategy,error)){
+        fprintf(stderr,"ERROR: %s\n",error);
+        exit(1);
+    }
+    return strategy;
+}
+
+int redstrategy_parse(const char *nomenclature, redstrategy *out, char *error){
     redstrategy strategy;
     strategy.nomenclature = nomenclature;
 
@@ -52,7 +70,10 @@ redstrategy redstrategy_from_nomenclature(const char *nomenclature){
     //
 
     int nomlen = strlen(nomenclature);
-    assert(nomlen<400);
+    if(nomlen>=400){
+        snprintf(error,REDSTRATEGY_ERROR_LEN,"Reduction \"%.40s...\" is too long!",strategy.nomenclature);
+        return 0;
+    }
     char nomenclature2[400];
     strcpy(nomenclature2,nomenclature);
 
@@ -72,8 +93,8 @@ redstrategy redstrategy_from_nomenclature(const char *nomenclature){
     int n_scan = sscanf(nomenclature2,"%s %d %s %d",
             abrev,&strategy.n_target,distm,&strategy.arg);
     if(n_scan<2){
-        fprintf(stderr,"ERROR: Invalid reduction format \"%s\"!\n",strategy.nomenclature);
-        exit(1);
+        snprintf(error,REDSTRATEGY_ERROR_LEN,"Invalid reduction format \"%s\"!",strategy.nomenclature);
+        return 0;
     }
 
     // Set the strategy arg to -1 if not given:
@@ -120,12 +141,12 @@ redstrategy redstrategy_from_nomenclature(const char *nomenclature){
         if(strategy_n_parts>3) invalid = 1;
     }
     else{
-        fprintf(stderr,"ERROR: Invalid reduction name \"%s\"!\n",abrev);
-        exit(1);
+        snprintf(error,REDSTRATEGY_ERROR_LEN,"Invalid reduction name \"%s\"!",abrev);
+        return 0;
     }
     if(invalid){
-        fprintf(stderr,"ERROR: Invalid reduction arguments \"%s\"!\n",strategy.nomenclature);
-        exit(1);
+        snprintf(error,REDSTRATEGY_ERROR_LEN,"Invalid reduction arguments \"%s\"!",strategy.nomenclature);
+        return 0;
     }
 
     // Identify the dissimilitude and distance strategies
@@ -167,12 +188,13 @@ redstrategy redstrategy_from_nomenclature(const char *nomenclature){
             strategy.facdis = FACDIS_NONE;
         }
         else{
-            fprintf(stderr,"ERROR: Invalid dissimilitude abrev \"%s\"!\n",distm);
-            exit(1);
+            snprintf(error,REDSTRATEGY_ERROR_LEN,"Invalid dissimilitude abrev \"%s\"!",distm);
+            return 0;
         }
     }
 
-    return strategy;
+    *out = strategy;
+    return 1;
 }
 
 facdismode redstrategy_required_facdis_mode(const redstrategy rstrat){
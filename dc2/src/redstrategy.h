@@ -47,12 +47,21 @@ typedef struct {
     int for_selected_sols;
 } redstrategy;
 
-// Allocates an array of redstrategies from nomenclatures
+// Size of the error messages of the parsing functions
+#define REDSTRATEGY_ERROR_LEN 512
+
+// Allocates an array of redstrategies from nomenclatures (the default ones if n_noms is 0), exits on an error
 redstrategy *redstrategy_init_from_nomenclatures(const char **noms, int *n_noms);
 
-// Parses a nomenclature to generate a redstrategy
+// Like redstrategy_init_from_nomenclatures, but retrieves NULL on an error, writing its message on error
+redstrategy *redstrategy_parse_nomenclatures(const char **noms, int *n_noms, char *error);
+
+// Parses a nomenclature to generate a redstrategy, exits on an error
 redstrategy redstrategy_from_nomenclature(const char *nomenclature);
 
+// Parses a nomenclature on out, retrieves 0 on an error, writing its message on error
+int redstrategy_parse(const char *nomenclature, redstrategy *out, char *error);
+
 // Gets the facdis mode required by this redstrategy
 facdismode redstrategy_required_facdis_mode(const redstrategy rstrat);
 
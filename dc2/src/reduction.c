@@ -1,9 +1,20 @@
 #include "reduction.h"
 
 void reduce_by_redstrategy(const rundata *run, const redstrategy rstrat,
-        solution **sols, int *n_sols){
+        solution **sols, int *n_sols, ranxoshi256 *rngen){
     if(*n_sols<=rstrat.n_target) return;
 
+    // Dissimilitudes between the assignments of the solutions are computed many times, so the ones that
+    // share assignments with their parents get their own ones first
+    if(run->delta_solutions && *n_sols>0 && (rstrat.method==REDUCTION_GLOVER_SDBS ||
+            rstrat.method==REDUCTION_GLOVER_SDBS_BESTS || rstrat.method==REDUCTION_VRHEURISTIC)){
+        int n_facs = sols[0]->n_facs;
+        if(rstrat.soldis==SOLDIS_PER_CLIENT_DELTA ||
+                (rstrat.soldis==SOLDIS_AUTO && n_facs*n_facs>15*rundata_original_n_clis(run))){
+            for(int i=0;i<*n_sols;i++) solution_make_writable(run->prob,&sols[i]);
+        }
+    }
+
     if(run->verbose) printf(
             "Reducing \033[31;1m%d\033[0m -> \033[31;1m%d\033[0m solutions, ",*n_sols,rstrat.n_target);
     if(rstrat.method==REDUCTION_BESTS){
@@ -15,14 +26,14 @@ void reduce_by_redstrategy(const rundata *run, const redstrategy rstrat,
             if(rstrat.elitist) printf("randomly (uniform, elitist).\n");
             else printf("randomly (uniform).\n");
         }
-        reduction_random_uniform(run,sols,n_sols,rstrat.n_target,rstrat.elitist);
+        reduction_random_uniform(run,sols,n_sols,rstrat.n_target,rstrat.elitist,rngen);
     }
     else if(rstrat.method==REDUCTION_RANDOM_RANK){
         if(run->verbose){
             if(rstrat.elitist) printf("randomly (by rank, elitist).\n");
             else printf("randomly (by rank).\n");
         }
-        reduction_random_rank(run,sols,n_sols,rstrat.n_target,rstrat.elitist);
+        reduction_random_rank(run,sols,n_sols,rstrat.n_target,rstrat.elitist,rngen);
     }
     else if(rstrat.method==REDUCTION_GLOVER_SDBS){
         if(run->verbose) printf("simple diversity-based starting method.\n");
@@ -46,10 +57,87 @@ void reduce_by_redstrategy(const rundata *run, const redstrategy rstrat,
     }
 }
 
+// Compare solvalpairs to sort them on decreasing value, breaking ties by index.
+int solvalpair_cmp(const void *a, const void *b){
+    const solvalpair *aa = a;
+    const solvalpair *bb = b;
+    if(aa->value>bb->value) return -1;
+    if(aa->value<bb->value) return +1;
+    return aa->indx - bb->indx;
+}
+
+solvalpair *new_solvalpairs(solution **sols, int n_sols){
+    solvalpair *pairs = safe_malloc(sizeof(solvalpair)*n_sols);
+    for(int i=0;i<n_sols;i++){
+        pairs[i].value = sols[i]->value;
+        pairs[i].indx = i;
+    }
+    return pairs;
+}
+
+static inline void solvalpair_swap(solvalpair *pairs, int a, int b){
+    solvalpair aux = pairs[a];
+    pairs[a] = pairs[b];
+    pairs[b] = aux;
+}
+
+void solvalpairs_select_bests(solvalpair *pairs, int len, int n_bests){
+    if(n_bests<=0 || n_bests>=len) return;
+    // Introselect: quickselect with median of 3, falling back to sorting if the recursion gets too deep
+    int depth = 2;
+    for(int l=len;l>1;l/=2) depth += 2;
+    int lo = 0;
+    int hi = len;
+    while(hi-lo>16){
+        if(depth==0){
+            qsort(&pairs[lo],hi-lo,sizeof(solvalpair),solvalpair_cmp);
+            return;
+        }
+        depth -= 1;
+        // Put the median of 3 at the end as pivot
+        int mid = lo+(hi-lo)/2;
+        if(solvalpair_cmp(&pairs[mid],&pairs[lo])<0) solvalpair_swap(pairs,mid,lo);
+        if(solvalpair_cmp(&pairs[hi-1],&pairs[lo])<0) solvalpair_swap(pairs,hi-1,lo);
+        if(solvalpair_cmp(&pairs[mid],&pairs[hi-1])<0) solvalpair_swap(pairs,mid,hi-1);
+        solvalpair pivot = pairs[hi-1];
+        // Partition, better pairs go first
+        int p = lo;
+        for(int i=lo;i<hi-1;i++){
+            if(solvalpair_cmp(&pairs[i],&pivot)<0){
+                solvalpair_swap(pairs,i,p);
+                p += 1;
+            }
+        }
+        solvalpair_swap(pairs,p,hi-1);
+        // Continue on the side that contains the n_bests-th position
+        if(n_bests<=p){
+            hi = p;
+        }else if(n_bests>p+1){
+            lo = p+1;
+        }else{
+            return;
+        }
+    }
+    qsort(&pairs[lo],hi-lo,sizeof(solvalpair),solvalpair_cmp);
+}
+
+void solutions_sort_bests(solution **sols, int n_sols, int n_bests){
+    if(n_bests>n_sols) n_bests = n_sols;
+    solvalpair *pairs = new_solvalpairs(sols,n_sols);
+    solvalpairs_select_bests(pairs,n_sols,n_bests);
+    qsort(pairs,n_bests,sizeof(solvalpair),solvalpair_cmp);
+    // Permute the solution pointers according to the pairs
+    solution **sols_cpy = safe_malloc(sizeof(solution *)*n_sols);
+    memcpy(sols_cpy,sols,sizeof(solution *)*n_sols);
+    for(int i=0;i<n_sols;i++) sols[i] = sols_cpy[pairs[i].indx];
+    free(sols_cpy);
+    free(pairs);
+}
+
 void reduction_bests(const rundata *run, solution **sols, int *n_sols, int n_target){
-    // Sort solutions in decreasing order
-    qsort(sols,*n_sols,sizeof(solution *),solutionp_value_cmp_inv);
-    assert(*n_sols<2 || sols[0]->value>=sols[1]->value);
+    // Move the n_target best solutions to the beginning, in decreasing order
+    solutions_sort_bests(sols,*n_sols,n_target);
+    assert(*n_sols<2 || n_target<2 || sols[0]->value>=sols[1]->value);
     // If there are already less solutions, do nothing.
     if(*n_sols<=n_target) return;
     // Free other solutions:
@@ -60,11 +148,12 @@ void reduction_bests(const rundata *run, solution **sols, int *n_sols, int n_tar
     *n_sols = n_target;
 }
 
-void reduction_random_uniform(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist){
+void reduction_random_uniform(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist,
+        ranxoshi256 *rngen){
     if(*n_sols<=n_target) return;
     // Put target_n randomly selected solutions first on the array, but keep the best so far if elitist.
     for(int i=elitist;i<n_target;i++){ // Fisher-Yates shuffle
-        int choice = i+rand()%(*n_sols-i);
+        int choice = i+rngen_below(rngen,*n_sols-i);
         solution *aux = sols[i];
         sols[i] = sols[choice];
         sols[choice] = aux;
@@ -78,11 +167,11 @@ void reduction_random_uniform(const rundata *run, solution **sols, int *n_sols,
 }
 
 void reduction_remove_worst(solution **sols, int *n_sols, double factor){
-    // Sort solutions in decreasing value
-    qsort(sols,*n_sols,sizeof(solution *),solutionp_value_cmp_inv);
     // How many solutions to delete?
     int n_delete = (int) floorf((*n_sols)*factor);
     assert(n_delete <= *n_sols);
+    // Move the solutions that are kept to the beginning, in decreasing value
+    solutions_sort_bests(sols,*n_sols,*n_sols-n_delete);
     // Delete last solutions in the array
     for(int i=0;i<n_delete;i++){
         int idx = *n_sols -1 - i;
@@ -6,21 +6,41 @@
 #include "problem.h"
 #include "rundata.h"
 #include "solution.h"
+#include "shuffle.h"
 
 // NOTE: not all functions are defined in reduction.c, there are also functions in reduction_*.c files.
 
+// Compact (value, index) pair of a solution, so that selection and sorting don't dereference solution pointers.
+typedef struct {
+    double value;
+    int indx;
+} solvalpair;
+
+// Creates the solvalpairs of an array of solutions.
+solvalpair *new_solvalpairs(solution **sols, int n_sols);
+
+// Moves the best n_bests solvalpairs to the beginning of the array (in no particular order), in expected O(len) time.
+void solvalpairs_select_bests(solvalpair *pairs, int len, int n_bests);
+
+// Reorders sols so that the first n_bests are the best ones in decreasing value, the others are left in no particular order.
+// Ties are broken by the original position, so the result is deterministic.
+void solutions_sort_bests(solution **sols, int n_sols, int n_bests);
+
 // Perform a redunction indicated by the given redstrategy
+// Random strategies draw from rngen, so each thread must provide its own.
 void reduce_by_redstrategy(const rundata *run, const redstrategy rstrat,
-        solution **sols, int *n_sols);
+        solution **sols, int *n_sols, ranxoshi256 *rngen);
 
 // Reduce the solutions, just picking the bests
 void reduction_bests(const rundata *run, solution **sols, int *n_sols, int n_target);
 
 // Reduce the solutions, picking representatives at random, uniformly.
-void reduction_random_uniform(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist);
+void reduction_random_uniform(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist,
+        ranxoshi256 *rngen);
 
 // Reduce the solutions, with probabilities according to their rank.
-void reduction_random_rank(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist);
+void reduction_random_rank(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist,
+        ranxoshi256 *rngen);
 
 // Reduce the solutions, using Glover's simple diversity-based starting
 // The best_of_clusters flag is used to indentify if the best of each cluster is selected,
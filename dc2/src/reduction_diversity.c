@@ -1,155 +1,195 @@
 #include "reduction.h"
 
+// Number of first centroids used as pivots for triangle inequality bounds on metric dissimilitudes.
+#define SDBS_N_PIVOTS 4
+
+typedef struct {
+    int dist_idx; // Index of the farthest solution found by a thread, -1 if none.
+    double dist;
+} farthest_cand;
+
 typedef struct {
     int thread_id;
     int n_target;
+    int n_pivots;
     int *centroids;
     int *is_centroid;
     int *nearest_cluster;
     double *nearest_dist;
-    double *current2oldcentroid_dist;
+    double *pivot_dist;       // Distance of each solution to each pivot (n_sols*n_pivots).
+    farthest_cand *farthests; // Farthest candidate of each thread, double buffered by step parity.
     const rundata *run;
     int n_sols;
     solution **sols;
     soldismode soldis;
     facdismode facdis;
-    sem_t *thread_sem;   // The main thread picked the next centroid.
-    sem_t *complete_sem; // Inform that thread has terminated updating its part of nearest_cluster.
+    dc_barrier *barrier;      // All threads proposed a candidate for the next centroid.
 } reductiondiv_thread_args;
 
+// Lower bound for the dissimilitude between solutions a and b, using the distances to the pivots.
+static inline double reductiondiv_pivot_bound(const reductiondiv_thread_args *args, int a, int b){
+    double bound = 0;
+    for(int p=0;p<args->n_pivots;p++){
+        double delta = args->pivot_dist[a*args->n_pivots+p] - args->pivot_dist[b*args->n_pivots+p];
+        if(delta<0) delta = -delta;
+        if(delta>bound) bound = delta;
+    }
+    return bound;
+}
+
 void *reductiondiv_thread_execution(void *arg){
     reductiondiv_thread_args *args = (reductiondiv_thread_args *) arg;
+    int n_threads = args->run->n_threads;
+    // Distance of the current centroid to the old ones, computed only when needed on this step
+    double *current2oldcentroid_dist = safe_malloc(sizeof(double)*args->n_target);
+    int *current2oldcentroid_step = safe_malloc(sizeof(int)*args->n_target);
+    for(int k=0;k<args->n_target;k++) current2oldcentroid_step[k] = -1;
+
+    int centroid = 0;
     for(int t=0;t<args->n_target;t++){
-        sem_wait(args->thread_sem);
-        int centroid = args->centroids[t];
-
-        // Help computing the distance of the new centroid to the old centroids
-        for(int k=args->thread_id;k<t;k+=args->run->n_threads){
-            int old_centroid = args->centroids[k];
-            if(k==args->nearest_cluster[centroid]){
-                // Make use of already computed distance to the old centroid
-                args->current2oldcentroid_dist[k] = args->nearest_dist[centroid];
-            }else{
-                double disim = solution_dissimilitude(args->run,
-                    args->sols[centroid],args->sols[old_centroid],args->soldis,args->facdis);
-                args->current2oldcentroid_dist[k] = disim;
+        // Pick the new centroid from the candidates of all the threads (the first one is the best solution)
+        if(t>0){
+            farthest_cand *cands = &args->farthests[(t%2)*n_threads];
+            int farthest = -1;
+            double fardist = -INFINITY;
+            for(int i=0;i<n_threads;i++){
+                if(cands[i].dist_idx==-1) continue;
+                if(cands[i].dist>fardist || (cands[i].dist==fardist && cands[i].dist_idx<farthest)){
+                    farthest = cands[i].dist_idx;
+                    fardist = cands[i].dist;
+                }
             }
+            assert(farthest!=-1);
+            centroid = farthest;
         }
-        sem_post(args->complete_sem);
-        sem_wait(args->thread_sem);
+        if(args->thread_id==0) args->centroids[t] = centroid;
+        if(centroid%n_threads==args->thread_id) args->is_centroid[centroid] = 1;
+        int is_pivot = t<args->n_pivots;
+
+        // Update the dissimilitudes to each cluster
+        for(int r=args->thread_id;r<args->n_sols;r+=n_threads){
+            if(is_pivot){
+                // Pivot distances are required for all solutions, even centroids.
+                double disim = 0;
+                if(r!=centroid){
+                    disim = solution_dissimilitude(args->run,
+                        args->sols[r],args->sols[centroid],args->soldis,args->facdis);
+                }
+                args->pivot_dist[r*args->n_pivots+t] = disim;
+                if(r==centroid || args->is_centroid[r]) continue;
+                if(disim<args->nearest_dist[r]){
+                    args->nearest_cluster[r] = t;
+                    args->nearest_dist[r] = disim;
+                }
+                continue;
+            }
+
+            if(r==centroid || args->is_centroid[r]) continue;
 
-        // Help updating the dissimilitudes to each cluster
-        for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
             /* It is not necessary to compute the dissimilitude between the
             new centroid and solution r if the distance between r and its old
             centroid is smaller than half the distance between the new centroid
-            and this old centroid. */
+            and this old centroid, or if the pivots already prove that r is
+            farther from the new centroid than from its old one. */
+            if(args->n_pivots>0 && reductiondiv_pivot_bound(args,r,centroid)>=args->nearest_dist[r]) continue;
+
+            if(t>0){
+                // The cluster where r currently is
+                int r_cluster = args->nearest_cluster[r];
+                int old_centroid = args->centroids[r_cluster];
+                if(args->n_pivots>0 && reductiondiv_pivot_bound(args,centroid,old_centroid)*0.5>=args->nearest_dist[r]) continue;
+                if(current2oldcentroid_step[r_cluster]!=t){
+                    if(r_cluster==args->nearest_cluster[centroid]){
+                        // Make use of already computed distance to the old centroid
+                        current2oldcentroid_dist[r_cluster] = args->nearest_dist[centroid];
+                    }else{
+                        current2oldcentroid_dist[r_cluster] = solution_dissimilitude(args->run,
+                            args->sols[centroid],args->sols[old_centroid],args->soldis,args->facdis);
+                    }
+                    current2oldcentroid_step[r_cluster] = t;
+                }
+                if(args->nearest_dist[r]<=0.5*current2oldcentroid_dist[r_cluster]) continue;
+            }
 
-            if(args->is_centroid[r]) continue;
+            double disim = solution_dissimilitude(args->run,
+                args->sols[r],args->sols[centroid],args->soldis,args->facdis);
+            if(disim<args->nearest_dist[r]){
+                args->nearest_cluster[r] = t;
+                args->nearest_dist[r] = disim;
+            }
+        }
 
-            // The cluster where r currently is
-            int r_cluster = args->nearest_cluster[r];
+        if(t==args->n_target-1) break;
 
-            if(t==0 || args->nearest_dist[r]>0.5*args->current2oldcentroid_dist[r_cluster]){
-                double disim = solution_dissimilitude(args->run,
-                    args->sols[r],args->sols[centroid],args->soldis,args->facdis);
-                if(disim<args->nearest_dist[r]){
-                    args->nearest_cluster[r] = t;
-                    args->nearest_dist[r] = disim;
-                }
+        // Propose the farthest solution of this thread as the next centroid
+        farthest_cand cand;
+        cand.dist_idx = -1;
+        cand.dist = -INFINITY;
+        for(int r=args->thread_id;r<args->n_sols;r+=n_threads){
+            if(r!=centroid && !args->is_centroid[r] && args->nearest_dist[r]>cand.dist){
+                cand.dist_idx = r;
+                cand.dist = args->nearest_dist[r];
             }
         }
-        sem_post(args->complete_sem);
+        args->farthests[((t+1)%2)*n_threads+args->thread_id] = cand;
+        dc_barrier_wait(args->barrier);
     }
+    free(current2oldcentroid_step);
+    free(current2oldcentroid_dist);
     return NULL;
 }
 
 void reduction_diversity_starting(const rundata *run, solution **sols, int *n_sols,
         int n_target, soldismode soldis, facdismode facdis, int bests_of_clusters){
     // Sort solutions in decreasing order
-    qsort(sols,*n_sols,sizeof(solution *),solutionp_value_cmp_inv);
+    solutions_sort_bests(sols,*n_sols,*n_sols);
     if(*n_sols<=n_target) return;
     // Indexes of selected centroids
     int *centroids = safe_malloc(sizeof(int)*n_target);
     int *is_centroid = safe_malloc(sizeof(int)*(*n_sols));
-    // Pick solution 0 as first centroid
-    centroids[0] = 0;
-    int n_centroids = 1;
     // Nearest cluster index and distance to it
     int *nearest_cluster = safe_malloc(sizeof(int)*(*n_sols));
     double *nearest_dist = safe_malloc(sizeof(double)*(*n_sols));
-    // Distance of the last centroid to the previous centroid
-    double *current2oldcentroid_dist = safe_malloc(sizeof(double)*n_target);
     // Creation of the first cluster including all the solutions.
     for(int i=0;i<*n_sols;i++){
         nearest_cluster[i] = -1;
         nearest_dist[i] = INFINITY;
         is_centroid[i] = 0;
     }
-    is_centroid[0] = 1;
+    // The first centroids are used as pivots when the dissimilitude satisfies the triangle inequality.
+    // The mean geometric error can violate it, since each facility is matched to its nearest one in the other solution.
+    int metric = soldis==SOLDIS_PER_CLIENT_DELTA;
+    int n_pivots = metric? SDBS_N_PIVOTS : 0;
+    if(n_pivots>n_target) n_pivots = n_target;
+    double *pivot_dist = safe_malloc(sizeof(double)*(*n_sols)*n_pivots+1);
+    farthest_cand *farthests = safe_malloc(sizeof(farthest_cand)*2*run->n_threads);
+    dc_barrier *barrier = dc_barrier_init(run->n_threads);
     // Create threads
     pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
-    sem_t **t_sems = safe_malloc(sizeof(sem_t *)*run->n_threads);
-    sem_t **c_sems = safe_malloc(sizeof(sem_t *)*run->n_threads);
     reductiondiv_thread_args *targs = safe_malloc(sizeof(reductiondiv_thread_args)*run->n_threads);
     for(int i=0;i<run->n_threads;i++){
-        // Init semaphores
-        t_sems[i] = dc_semaphore_init();
-        c_sems[i] = dc_semaphore_init();
-
         // Thread args
         targs[i].thread_id = i;
         targs[i].n_target = n_target;
+        targs[i].n_pivots = n_pivots;
         targs[i].is_centroid = is_centroid;
         targs[i].centroids = centroids;
         targs[i].nearest_cluster = nearest_cluster;
         targs[i].nearest_dist = nearest_dist;
-        targs[i].current2oldcentroid_dist = current2oldcentroid_dist;
+        targs[i].pivot_dist = pivot_dist;
+        targs[i].farthests = farthests;
         targs[i].run = run;
         targs[i].n_sols = *n_sols;
         targs[i].sols = sols;
         targs[i].soldis = soldis;
         targs[i].facdis = facdis;
-        targs[i].thread_sem = t_sems[i];
-        targs[i].complete_sem = c_sems[i];
+        targs[i].barrier = barrier;
         int rc = pthread_create(&threads[i],NULL,reductiondiv_thread_execution,&targs[i]);
         if(rc){
             fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
             exit(1);
         }
     }
-    for(int t=0;t<n_target;t++){
-
-        // Allow threads to compute current2oldcentroid_dist
-        for(int i=0;i<run->n_threads;i++) sem_post(t_sems[i]);
-        // Wait for all threads to finish
-        for(int i=0;i<run->n_threads;i++) sem_wait(c_sems[i]);
-
-        // Allow threads to update the centroids of each solution
-        for(int i=0;i<run->n_threads;i++) sem_post(t_sems[i]);
-        // Wait for all threads to finish
-        for(int i=0;i<run->n_threads;i++) sem_wait(c_sems[i]);
-
-        if(t==n_target-1) break;
-
-        // Find the new centroid
-        int farthest = -1;
-        double fardist = -INFINITY;
-        for(int i=1;i<*n_sols;i++){
-            if(!is_centroid[i] && nearest_dist[i] > fardist){
-                farthest = i;
-                fardist = nearest_dist[farthest];
-            }
-        }
-        assert(farthest!=-1);
-
-        // Add the new centroid
-        centroids[n_centroids] = farthest;
-        assert(!is_centroid[farthest]);
-        is_centroid[farthest] = 1;
-        n_centroids += 1;
-    }
-    assert(n_centroids==n_target);
 
     // Join threads
     for(int i=0;i<run->n_threads;i++){
@@ -157,14 +197,10 @@ void reduction_diversity_starting(const rundata *run, solution **sols, int *n_so
     }
     free(threads);
     free(targs);
-
-    // Destroy semaphores
-    for(int i=0;i<run->n_threads;i++){
-        dc_semaphore_free(c_sems[i]);
-        dc_semaphore_free(t_sems[i]);
-    }
-    free(c_sems);
-    free(t_sems);
+    dc_barrier_free(barrier);
+    free(farthests);
+    free(pivot_dist);
+    int n_centroids = n_target;
 
     /* Select final solutions */
     // Ensure that the centroid is part of its cluster (in case of distance 0 ties)
@@ -201,7 +237,6 @@ void reduction_diversity_starting(const rundata *run, solution **sols, int *n_so
     *n_sols = n_target;
 
     // Free remaining arrays
-    free(current2oldcentroid_dist);
     free(nearest_dist);
     free(nearest_cluster);
     free(is_centroid);
@@ -1,25 +1,38 @@
 #include "reduction.h"
 
-typedef long long int weight;
+// If the number of picks is at least len/RANK_BATCH_FACTOR, all of them are drawn in a single batched pass.
+#define RANK_BATCH_FACTOR 16
+
+// Builds a segment tree with the given leaf weights in O(len).
+double *new_segtree(const double *weights, int len){
+    double *segtree = safe_malloc(sizeof(double)*len*2);
+    segtree[0] = 0;
+    for(int k=0;k<len;k++) segtree[len+k] = weights[k];
+    for(int p=len-1;p>0;p--) segtree[p] = segtree[2*p]+segtree[2*p+1];
+    return segtree;
+}
 
 // Updates the probability weight at position k in the given segmentree.
-void segtree_update(weight *segtree, int len, int k, weight val){
+void segtree_update(double *segtree, int len, int k, double val){
     int p = len + k;
-    weight delta = val - segtree[p];
+    segtree[p] = val;
+    p /= 2;
     while(p>0){
-        segtree[p] += delta;
+        // Recompute the sums instead of adding deltas, so rounding errors don't accumulate
+        segtree[p] = segtree[2*p]+segtree[2*p+1];
         p /= 2;
     }
 }
 
 // Picks a node at random from the segment tree, retrieves it.
-int segtree_pick(weight *segtree, int len){
-    weight total = segtree[1];
+int segtree_pick(double *segtree, int len, ranxoshi256 *rngen){
+    double total = segtree[1];
     assert(total>0);
-    weight r = (weight)(((double)rand()/RAND_MAX)*total);
+    double r = ranxoshi256DoubleCO(rngen)*total;
     int p = 1;
     while(p<len){
-        if(r>=segtree[2*p]){
+        // Never go down to a subtree without weight, even with rounding errors
+        if(segtree[2*p+1]>0 && (r>=segtree[2*p] || segtree[2*p]<=0)){
             r -= segtree[2*p];
             p = 2*p+1;
         }else{
@@ -29,34 +42,51 @@ int segtree_pick(weight *segtree, int len){
     return p-len;
 }
 
-void reduction_random_rank(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist){
+void reduction_random_rank(const rundata *run, solution **sols, int *n_sols, int n_target, int elitist,
+        ranxoshi256 *rngen){
     if(*n_sols<=n_target) return;
     // Sort solutions in decreasing order
-    qsort(sols,*n_sols,sizeof(solution *),solutionp_value_cmp_inv);
+    solutions_sort_bests(sols,*n_sols,*n_sols);
     // Solutions that were picked
     int *picked = safe_malloc(sizeof(int)*(*n_sols));
     for(int i=0;i<(*n_sols);i++) picked[i] = 0;
-    // Probability weight segment tree
-    weight *pws = safe_malloc(sizeof(weight)*(*n_sols)*2);
-    for(int i=0;i<(*n_sols)*2;i++){
-        pws[i] = 0;
-    }
     // The first solution is always picked if elitist (unless n_target==0)
     picked[0] = (elitist && n_target>0);
     int n_picked = picked[0];
-    // Initial probabilities
-    for(int i=elitist;i<*n_sols;i++){
-        weight pw = 100000000/(i+1);
-        if(pw<1) pw = 1;
-        segtree_update(pws,*n_sols,i,pw);
+    // Probability weights, the reciprocal of the rank
+    double *weights = safe_malloc(sizeof(double)*(*n_sols));
+    for(int i=0;i<*n_sols;i++){
+        weights[i] = (i<elitist)? 0 : 1.0/(i+1);
     }
-    // Start picking solutions
-    while(n_picked<n_target){
-        // Get a solution at random from the segment tree
-        int k = segtree_pick(pws,*n_sols);
-        picked[k] = 1;
-        segtree_update(pws,*n_sols,k,0);
-        n_picked++;
+    if(n_target-n_picked >= (*n_sols)/RANK_BATCH_FACTOR){
+        /* Draw all picks at once (Efraimidis and Spirakis): each solution gets the key u^(1/w),
+        the ones with the largest keys have the same distribution as picking one by one without
+        replacement. The keys are compared by their logarithm log(u)/w = (i+1)*log(u). */
+        solvalpair *keys = safe_malloc(sizeof(solvalpair)*(*n_sols));
+        int n_keys = 0;
+        for(int i=elitist;i<*n_sols;i++){
+            double u = 1.0-ranxoshi256DoubleCO(rngen); // in (0,1]
+            keys[n_keys].value = log(u)/weights[i];
+            keys[n_keys].indx = i;
+            n_keys++;
+        }
+        solvalpairs_select_bests(keys,n_keys,n_target-n_picked);
+        for(int k=0;k<n_target-n_picked;k++) picked[keys[k].indx] = 1;
+        n_picked = n_target;
+        free(keys);
+    }else{
+        // Probability weight segment tree
+        double *pws = new_segtree(weights,*n_sols);
+        // Start picking solutions
+        while(n_picked<n_target){
+            // Get a solution at random from the segment tree
+            int k = segtree_pick(pws,*n_sols,rngen);
+            assert(!picked[k]);
+            picked[k] = 1;
+            segtree_update(pws,*n_sols,k,0);
+            n_picked++;
+        }
+        free(pws);
     }
     // Delete not picked solutions
     int n_final = 0;
@@ -70,6 +100,6 @@ void reduction_random_rank(const rundata *run, solution **sols, int *n_sols, int
     }
     *n_sols = n_final;
     // Free memory
-    free(pws);
+    free(weights);
     free(picked);
-}
\ No newline at end of file
+}
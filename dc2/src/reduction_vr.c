@@ -11,12 +11,9 @@ typedef struct {
 
 // Compare dissimpairs by dissimilitude (<0 means a has less dissimilitude)
 int dissimpair_cmp(dissimpair a, dissimpair b){
-    double delta = a.dissim - b.dissim;
-    if(delta!=0) return delta;
-    delta = a.id1-b.id1;
-    if(delta!=0) return delta;
-    delta = a.id2-b.id2;
-    return delta;
+    if(a.dissim!=b.dissim) return a.dissim<b.dissim? -1 : 1;
+    if(a.id1!=b.id1) return a.id1-b.id1;
+    return a.id2-b.id2;
 }
 
 // A heap of dissimpairs
@@ -62,9 +59,12 @@ dissimpair pairheap_poll(pairheap *heap){
     return ret;
 }
 
-// Adds a dissimpair to the heap.
+// Adds a dissimpair to the heap, growing it if it is full.
 void pairheap_add(pairheap *heap, dissimpair val){
-    assert(heap->len<heap->size);
+    if(heap->len==heap->size){
+        heap->size = 2*heap->size+1;
+        heap->elems = safe_realloc(heap->elems,sizeof(dissimpair)*heap->size);
+    }
     heap->len += 1;
     heap->elems[heap->len-1] = val;
     // Heapify up:
@@ -79,59 +79,95 @@ void pairheap_add(pairheap *heap, dissimpair val){
     }
 }
 
+// Removes the dissimpairs that involve discarded solutions, then restores the heap property in O(len).
+void pairheap_purge(pairheap *heap, const int *discarted){
+    lint len2 = 0;
+    for(lint k=0;k<heap->len;k++){
+        dissimpair pair = heap->elems[k];
+        if(!discarted[pair.id1] && !discarted[pair.id2]){
+            heap->elems[len2] = pair;
+            len2 += 1;
+        }
+    }
+    heap->len = len2;
+    // Heapify down from the last parent to the root:
+    for(lint s=heap->len/2-1;s>=0;s--){
+        lint i = s;
+        lint c = 2*i+1;
+        while(c<heap->len){
+            if(c+1<heap->len && dissimpair_cmp(heap->elems[c+1],heap->elems[c])<0) c = c+1;
+            if(dissimpair_cmp(heap->elems[i],heap->elems[c])<0) break;
+            dissimpair aux = heap->elems[i];
+            heap->elems[i] = heap->elems[c];
+            heap->elems[c] = aux;
+            i = c;
+            c = 2*i+1;
+        }
+    }
+}
+
+// Maximum number of non-conflicting solutions deleted each time the threads are waken.
+// The deletions of a batch are speculative, the ones that sequential VR wouldn't have done yet are undone.
+#define VR_DELETION_BATCH 32
+
 typedef struct {
     // Parameters
     int thread_id;
     int vision_range;
     soldismode soldis;
     facdismode facdis;
-    // Concurrent axes to heap
-    pthread_mutex_t *heap_mutex;
+    // Local heap of this thread, for the initial pairs
     pairheap *heap;
     // Solutions (read only)
     const rundata *run;
     int n_sols;
     const solution **sols;
-    // Fast way of getting previous and next solutions
+    const int *discarted;
+    // Fast way of getting previous and next solutions of each deleted solution on the batch
     const int *prev_sols;
     const int *next_sols;
+    const int *n_batch;
+    // Replacement pairs of each deleted solution on the batch, id1 is -1 if there is no pair
+    dissimpair *new_pairs;
     // Semaphores
     sem_t *thread_sem;   // The main thread finished.
     sem_t *complete_sem; // Inform that thread has finished.
     int *terminated;     // For the main thread to inform that the job is done.
 } reductionvr_thread_args;
 
+// Adds a new pair to a heap, purging discarded pairs before growing it.
+static inline void reductionvr_add_pair(pairheap *heap, const int *discarted, dissimpair pair){
+    if(heap->len==heap->size){
+        pairheap_purge(heap,discarted);
+        // Grow in advance if most of the heap is still alive, to avoid purging too often
+        if(4*heap->len>=3*heap->size){
+            heap->size = 2*heap->size+1;
+            heap->elems = safe_realloc(heap->elems,sizeof(dissimpair)*heap->size);
+        }
+    }
+    pairheap_add(heap,pair);
+}
+
 void *reductionvr_thread_execution(void *arg){
     reductionvr_thread_args *args = (reductionvr_thread_args *) arg;
 
-    { // Help building initial set of dissimilitude pairs
-        dissimpair *pairs = safe_malloc(sizeof(dissimpair)*args->vision_range);
-        int n_pairs = 0;
+    { // Help building initial set of dissimilitude pairs, on the local heap.
         for(int i=args->thread_id;i<args->n_sols;i+=args->run->n_threads){
             for(int j=1;j<=args->vision_range;j++){
                 if(i+j>=args->n_sols) break;
-                pairs[n_pairs].id1 = i;
-                pairs[n_pairs].id2 = i+j;
-                pairs[n_pairs].dissim = solution_dissimilitude(
+                dissimpair pair;
+                pair.id1 = i;
+                pair.id2 = i+j;
+                pair.dissim = solution_dissimilitude(
                     args->run,args->sols[i],args->sols[i+j],
                     args->soldis,args->facdis);
-                n_pairs += 1;
+                pairheap_add(args->heap,pair);
             }
-            // Add pairs to the heap
-            pthread_mutex_lock(args->heap_mutex);
-                for(int k=0;k<n_pairs;k++) pairheap_add(args->heap,pairs[k]);
-            pthread_mutex_unlock(args->heap_mutex);
-            // Delete pairs
-            n_pairs = 0;
         }
-        free(pairs);
     }
 
     { // Wake when required to compute new dissimilitudes
-        dissimpair *pair_buffer = safe_malloc(sizeof(dissimpair)
-            *(1+args->vision_range/args->run->n_threads));
-        int pair_buffer_len = 0;
-        // Each time a solution is deleted
+        // Each time a batch of solutions is deleted
         while(1){
             sem_post(args->complete_sem);
             // ---@> Main thread works here.
@@ -140,46 +176,42 @@ void *reductionvr_thread_execution(void *arg){
             assert(args->next_sols!=NULL);
             // If main thread says the job is done, break
             if(*args->terminated) break;
-            // Create new pairs
-            for(int i=args->thread_id;i<args->vision_range;i+=args->run->n_threads){
-                int pair_a = args->prev_sols[args->vision_range-1-i];
-                int pair_b = args->next_sols[i];
+            // Create new pairs, vision_range for each deleted solution
+            int n_new_pairs = (*args->n_batch)*args->vision_range;
+            for(int k=args->thread_id;k<n_new_pairs;k+=args->run->n_threads){
+                int b = k/args->vision_range;
+                int i = k%args->vision_range;
+                int pair_a = args->prev_sols[b*args->vision_range+args->vision_range-1-i];
+                int pair_b = args->next_sols[b*args->vision_range+i];
+                // Create the replace dissimpair:
+                dissimpair pair;
+                pair.id1 = -1;
+                pair.id2 = -1;
+                pair.dissim = INFINITY;
                 if(pair_a!=-1 && pair_b!=-1){
-                    // Create the replace dissimpair:
-                    dissimpair pair;
                     pair.id1 = pair_a;
                     pair.id2 = pair_b;
                     pair.dissim = solution_dissimilitude(args->run,
                         args->sols[pair_a],args->sols[pair_b],
                         args->soldis,args->facdis);
-                    // Add to pair buffer:
-                    pair_buffer[pair_buffer_len] = pair;
-                    pair_buffer_len += 1;
-                    // Add pairs in buffer to to the heap if mutex is free
-                    if(pthread_mutex_trylock(args->heap_mutex)==0){
-                        for(int k=0;k<pair_buffer_len;k++){
-                            pairheap_add(args->heap,pair_buffer[k]);
-                        }
-                        pthread_mutex_unlock(args->heap_mutex);
-                        pair_buffer_len = 0;
-                    }
                 }
-            }
-            // If pairs remain, wait for mutex
-            if(pair_buffer_len>0){
-                pthread_mutex_lock(args->heap_mutex);
-                for(int i=0;i<pair_buffer_len;i++){
-                    pairheap_add(args->heap,pair_buffer[i]);
-                }
-                pthread_mutex_unlock(args->heap_mutex);
-                pair_buffer_len = 0;
+                args->new_pairs[k] = pair;
             }
         }
-        free(pair_buffer);
     }
     return NULL;
 }
 
+// Retrieves the index of the local heap with the smallest dissimpair on top, -1 if all are empty.
+int reductionvr_min_heap(pairheap **heaps, int n_heaps){
+    int best = -1;
+    for(int i=0;i<n_heaps;i++){
+        if(heaps[i]->len==0) continue;
+        if(best==-1 || dissimpair_cmp(heaps[i]->elems[0],heaps[best]->elems[0])<0) best = i;
+    }
+    return best;
+}
+
 void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
         int n_target, soldismode soldis, facdismode facdis, int vision_range){
     assert(vision_range>0);
@@ -187,22 +219,37 @@ void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
     // Ensure that the vision_range isn't larger than the number of solutions.
     if(vision_range>*n_sols) vision_range = *n_sols;
     // Sort solutions in decreasing order
-    qsort(sols,*n_sols,sizeof(solution *),solutionp_value_cmp_inv);
+    solutions_sort_bests(sols,*n_sols,*n_sols);
     // Return if there is no need of reduction.
     if(*n_sols<=n_target) return;
     // To know if a solution has been discarded:
     int *discarted = safe_malloc((*n_sols)*sizeof(int));
     for(int i=0;i<*n_sols;i++) discarted[i] = 0;
+    // Batch in which a solution was last near a deleted one, so that deletions on a batch don't conflict
+    int *touched = safe_malloc((*n_sols)*sizeof(int));
+    for(int i=0;i<*n_sols;i++) touched[i] = -1;
 
-    // The solutions previous and next to the last deleted solution
+    // The solutions previous and next to each deleted solution of the batch
     // (to communicate with the threads).
-    int *prev_sols = safe_malloc(sizeof(int)*vision_range);
-    int *next_sols = safe_malloc(sizeof(int)*vision_range);
+    int n_batch = 0;
+    int *prev_sols = safe_malloc(sizeof(int)*vision_range*VR_DELETION_BATCH);
+    int *next_sols = safe_malloc(sizeof(int)*vision_range*VR_DELETION_BATCH);
+    dissimpair *new_pairs = safe_malloc(sizeof(dissimpair)*vision_range*VR_DELETION_BATCH);
+    // The pair that caused each deletion of the batch, and the position on the batch of each deleted solution
+    dissimpair *batch_pairs = safe_malloc(sizeof(dissimpair)*VR_DELETION_BATCH);
+    int *batch_pos = safe_malloc((*n_sols)*sizeof(int));
+    for(int i=0;i<*n_sols;i++) batch_pos[i] = -1;
+    // Pairs polled on the batch because they involve a solution deleted on it, restored if the deletion is undone
+    int dropped_size = 2*VR_DELETION_BATCH*vision_range;
+    dissimpair *dropped = safe_malloc(sizeof(dissimpair)*dropped_size);
+    int n_dropped;
 
-    // Heap of dissimilitude pairs
-    pairheap *heap = pairheap_init(2*(*n_sols)*vision_range);
-    pthread_mutex_t heap_mutex;
-    pthread_mutex_init(&heap_mutex,NULL);
+    // Local heaps of dissimilitude pairs, one for each thread, sized for its initial pairs
+    pairheap **heaps = safe_malloc(sizeof(pairheap *)*run->n_threads);
+    for(int i=0;i<run->n_threads;i++){
+        lint n_owned = (*n_sols-i+run->n_threads-1)/run->n_threads;
+        heaps[i] = pairheap_init(n_owned*vision_range+1);
+    }
 
     // Create threads:
     pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
@@ -221,16 +268,18 @@ void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
         targs[i].vision_range = vision_range;
         targs[i].soldis = soldis;
         targs[i].facdis = facdis;
-        // Concurrent axes to heap
-        targs[i].heap_mutex = &heap_mutex;
-        targs[i].heap = heap;
+        // Local heap
+        targs[i].heap = heaps[i];
         // Solutions (read only)
         targs[i].run = run;
         targs[i].n_sols = *n_sols;
         targs[i].sols = (const solution **) sols;
+        targs[i].discarted = discarted;
         // Fast way of getting previous and next solutions
         targs[i].prev_sols = prev_sols;
         targs[i].next_sols = next_sols;
+        targs[i].n_batch = &n_batch;
+        targs[i].new_pairs = new_pairs;
         // Semaphores
         targs[i].thread_sem = t_sems[i];
         targs[i].complete_sem = c_sems[i];
@@ -263,50 +312,129 @@ void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
     // Eliminate as many solutions as required:
     int n_eliminate = *n_sols-n_target;
     int elims = 0;
+    int batch_id = 0;
+    int next_heap = 0;
+    // Adapts to how many deletions are valid, to avoid computing the pairs of the undone ones
+    int batch_limit = VR_DELETION_BATCH;
     while(elims<n_eliminate){
-        // Eliminate worst solution of most similar pair
-        if(heap->len==0) break;
-        dissimpair pair = pairheap_poll(heap);
-        if(!discarted[pair.id1] && !discarted[pair.id2]){
-            // Delete the second solution on the pair.
+        // Eliminate worst solution of most similar pairs, while they don't conflict with the batch
+        n_batch = 0;
+        n_dropped = 0;
+        while(n_batch<batch_limit && elims<n_eliminate){
+            int h = reductionvr_min_heap(heaps,run->n_threads);
+            if(h==-1) break;
+            dissimpair pair = heaps[h]->elems[0];
+            if(discarted[pair.id1] || discarted[pair.id2]){
+                pairheap_poll(heaps[h]);
+                if(batch_pos[pair.id1]!=-1 || batch_pos[pair.id2]!=-1){
+                    if(n_dropped==dropped_size){
+                        dropped_size *= 2;
+                        dropped = safe_realloc(dropped,sizeof(dissimpair)*dropped_size);
+                    }
+                    dropped[n_dropped] = pair;
+                    n_dropped += 1;
+                }
+                continue;
+            }
+            // The pairs of this deletion may depend on the ones of a previous deletion on the batch
+            if(touched[pair.id1]==batch_id || touched[pair.id2]==batch_id) break;
+            pairheap_poll(heaps[h]);
+            // Delete the second solution on the pair (it is freed once the batch is confirmed).
             int to_delete = pair.id2;
             discarted[to_delete] = 1;
-            solution_free(sols[to_delete]);
+            batch_pos[to_delete] = n_batch;
+            batch_pairs[n_batch] = pair;
             elims += 1;
             // Update double linked list:
             if(nexts[to_delete]!=-1) prevs[nexts[to_delete]] = prevs[to_delete];
             if(prevs[to_delete]!=-1) nexts[prevs[to_delete]] = nexts[to_delete];
             // Add new pairs to replace those that will be deleted on the destroyed solution.
+            int *b_next_sols = &next_sols[n_batch*vision_range];
+            int *b_prev_sols = &prev_sols[n_batch*vision_range];
             int iter;
             // Get solutions after
             iter = to_delete;
             for(int i=0;i<vision_range;i++){
                 if(nexts[iter]==-1){
-                    next_sols[i] = -1;
+                    b_next_sols[i] = -1;
                 }else{
                     iter = nexts[iter];
-                    next_sols[i] = iter;
+                    b_next_sols[i] = iter;
+                    touched[iter] = batch_id;
                 }
             }
             // Get solutions before
             iter = to_delete;
             for(int i=0;i<vision_range;i++){
                 if(prevs[iter]==-1){
-                    prev_sols[i] = -1;
+                    b_prev_sols[i] = -1;
                 }else{
                     iter = prevs[iter];
-                    prev_sols[i] = iter;
+                    b_prev_sols[i] = iter;
+                    touched[iter] = batch_id;
                 }
             }
-            // Wake threads to create new pairs
-            for(int i=0;i<run->n_threads;i++){
-                sem_post(t_sems[i]);
-            }
-            // Wait for all threads to terminate their job
-            for(int i=0;i<run->n_threads;i++){
-                sem_wait(c_sems[i]);
+            n_batch += 1;
+        }
+        if(n_batch==0) break;
+        batch_id += 1;
+        // Wake threads to create new pairs
+        for(int i=0;i<run->n_threads;i++){
+            sem_post(t_sems[i]);
+        }
+        // Wait for all threads to terminate their job
+        for(int i=0;i<run->n_threads;i++){
+            sem_wait(c_sems[i]);
+        }
+        // Sequential VR polls the replacement pairs of a deletion before any pair that is larger, so the batch
+        // is only valid up to the first deletion whose pair is larger than a pending replacement pair.
+        int n_valid = n_batch;
+        for(int b=1;b<n_batch && n_valid==n_batch;b++){
+            for(int k=0;k<b*vision_range;k++){
+                dissimpair pair = new_pairs[k];
+                if(pair.id1==-1) continue;
+                // Pairs discarded by a deletion before b aren't pending
+                int pos1 = batch_pos[pair.id1];
+                int pos2 = batch_pos[pair.id2];
+                if((pos1!=-1 && pos1<b) || (pos2!=-1 && pos2<b)) continue;
+                if(dissimpair_cmp(pair,batch_pairs[b])<0){
+                    n_valid = b;
+                    break;
+                }
             }
         }
+        if(n_valid<n_batch) batch_limit = n_valid;
+        else if(n_batch==batch_limit && 2*batch_limit<=VR_DELETION_BATCH) batch_limit *= 2;
+        // Undo the invalid deletions in reverse order, then restore their pairs
+        // (not before, as adding a pair may purge the heap of the pairs of discarded solutions)
+        for(int b=n_batch-1;b>=n_valid;b--){
+            int to_restore = batch_pairs[b].id2;
+            discarted[to_restore] = 0;
+            batch_pos[to_restore] = -1;
+            elims -= 1;
+            if(nexts[to_restore]!=-1) prevs[nexts[to_restore]] = to_restore;
+            if(prevs[to_restore]!=-1) nexts[prevs[to_restore]] = to_restore;
+        }
+        for(int b=n_valid;b<n_batch;b++){
+            reductionvr_add_pair(heaps[next_heap],discarted,batch_pairs[b]);
+            next_heap = (next_heap+1)%run->n_threads;
+        }
+        for(int k=0;k<n_dropped;k++){
+            if(discarted[dropped[k].id1] || discarted[dropped[k].id2]) continue;
+            reductionvr_add_pair(heaps[next_heap],discarted,dropped[k]);
+            next_heap = (next_heap+1)%run->n_threads;
+        }
+        // Confirm the valid deletions and add their replacement pairs
+        for(int b=0;b<n_valid;b++){
+            int deleted = batch_pairs[b].id2;
+            batch_pos[deleted] = -1;
+            solution_free(sols[deleted]);
+        }
+        for(int k=0;k<n_valid*vision_range;k++){
+            if(new_pairs[k].id1==-1) continue;
+            reductionvr_add_pair(heaps[next_heap],discarted,new_pairs[k]);
+            next_heap = (next_heap+1)%run->n_threads;
+        }
     }
 
     // Wake threads for termination
@@ -333,8 +461,13 @@ void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
     // Free prev and next sols arrays
     free(prev_sols);
     free(next_sols);
+    free(new_pairs);
+    free(batch_pairs);
+    free(batch_pos);
+    free(dropped);
     // Free all the pairs:
-    pairheap_free(heap);
+    for(int i=0;i<run->n_threads;i++) pairheap_free(heaps[i]);
+    free(heaps);
     // Set output final array:
     int new_nsols=0;
     for(int i=0;i<*n_sols;i++){
@@ -345,7 +478,8 @@ void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
     }
     *n_sols = new_nsols;
     // Free arrays
+    free(touched);
     free(discarted);
     free(nexts);
     free(prevs);
-}
\ No newline at end of file
+}
@@ -1,4 +1,9 @@
 #include "rundata.h"
+#include "lsmemo.h"
+#include "dualbound.h"
+#include "preprocess.h"
+#include "profiler.h"
+#include "solution.h"
 
 const char *filter_names[] = {
     "NO_FILTER",
@@ -24,6 +29,17 @@ const char *path_relinking_names[] = {
 void rundata_free(rundata *data){
     // Free precomputations
     runprecomp_free(data->precomp);
+    // Free dual bounds
+    if(data->dual_bound!=NULL) dualbound_free(data->dual_bound);
+    // Free local search memo
+    if(data->ls_memo!=NULL) lsmemo_free(data->ls_memo);
+    // Free initial solutions
+    for(int i=0;i<data->n_init_sols;i++) solution_free(data->init_sols[i]);
+    free(data->init_sols);
+    // Free preprocessing
+    if(data->prepro!=NULL) preprocessing_free(data->prepro);
+    // Free profiler
+    if(data->prof!=NULL) profiler_free(data->prof);
     // Free run info
     runinfo_free(data->run_inf);
     // Free problem
@@ -38,20 +54,35 @@ void rundata_free(rundata *data){
 rundata *rundata_init(problem *prob, redstrategy *rstrats, int n_rstrats, int n_restarts, int precomp_nearly_indexes, int n_threads, int verbose){
     rundata *run = safe_malloc(sizeof(rundata));
 
-    run->prob = problem_copy(prob);
-    prob = run->prob;
+    run->prob = prob;
+    run->prepro = NULL;
+    run->prof = NULL;
+    run->prof_set = 0;
+    run->callbacks = NULL;
 
     run->filter = FILTER_DEFAULT;
     run->branch_and_bound = BRANCH_AND_BOUND_DEFAULT;
     run->random_seed = 42;
     run->n_restarts = n_restarts;
+    run->parallel_restarts = DEFAULT_PARALLEL_RESTARTS;
+    run->time_limit = DEFAULT_TIME_LIMIT;
+    run->time_limit_cpu = 0;
+    run->anytime_fname = NULL;
+    run->checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+    run->checkpoint_fname = NULL;
+    run->resume = 0;
 
     // Default values
     run->bnb_lower_bound = -INFINITY;
+    run->dual_bound = NULL;
     run->verbose     = verbose;
+    run->output_csv  = 0;
     run->branching_factor     = DEFAULT_BRANCHING_FACTOR;
     run->branching_correction = DEFAULT_BRANCHING_CORRECTION;
     run->path_relinking   = DEFAULT_PATH_RELINKING;
+    run->pr_partners      = 0;
+    run->pr_truncate      = 1;
+    run->pr_round_robin   = 0;
 
     run->target_sols  = DEFAULT_TARGET_SOLS;
     run->n_threads    = n_threads;
@@ -61,6 +92,12 @@ rundata *rundata_init(problem *prob, redstrategy *rstrats, int n_rstrats, int n_
     run->select_only_terminal = DEFAULT_SELECT_ONLY_TERMINAL;
     run->local_search_rem_movement = DEFAULT_LOCAL_SEARCH_SIZE_CHANGE_MOVEMENTS_ENABLED;
     run->local_search_add_movement = DEFAULT_LOCAL_SEARCH_SIZE_CHANGE_MOVEMENTS_ENABLED;
+    run->ls_memo = NULL;
+    run->delta_solutions = 0;
+    run->init_sols = NULL;
+    run->n_init_sols = 0;
+    run->init_local_search = 0;
+    run->init_start = 0;
 
     // Initialize runinfo
     run->run_inf = runinfo_init(prob,n_restarts);
@@ -68,18 +105,53 @@ rundata *rundata_init(problem *prob, redstrategy *rstrats, int n_rstrats, int n_
     // Initialize precomputations and perform them
     run->precomp = runprecomp_init(prob,rstrats,n_rstrats,precomp_nearly_indexes,run->n_threads,run->verbose);
 
+    rundata_start_timer(run);
+
     return run;
 }
 
+void rundata_start_timer(rundata *run){
+    run->start_clock = clock();
+    gettimeofday(&run->start_time,NULL);
+}
+
+double rundata_elapsed(const rundata *run){
+    struct timeval now;
+    gettimeofday(&now,NULL);
+    return (double)(now.tv_sec - run->start_time.tv_sec) + 1e-6*(now.tv_usec - run->start_time.tv_usec);
+}
+
+double rundata_seconds(const rundata *run){
+    if(run->time_limit_cpu){
+        return (double)(clock() - run->start_clock) / (double)CLOCKS_PER_SEC;
+    }
+    return rundata_elapsed(run);
+}
+
+int rundata_time_is_up(const rundata *run){
+    if(run->callbacks!=NULL && run->callbacks->stop) return 1;
+    if(run->time_limit<=0) return 0;
+    return rundata_seconds(run) >= run->time_limit;
+}
+
 // Prints a briefing of the rundata parameters
 void rundata_print(const rundata *run, FILE *fp){
-    const problem *prob = run->prob;
+    // Sizes of the original problem
+    const problem *prob = run->prepro!=NULL? run->prepro->orig : run->prob;
 
     fprintf(fp,"== PROBLEM ==\n");
     fprintf(fp,"# N_FACILITIES: %d\n",prob->n_facs);
     fprintf(fp,"# N_CLIENTS: %d\n",prob->n_clis);
     fprintf(fp,"# SIZE_RESTRICTION_MINIMUM: %d\n",prob->size_restriction_minimum);
     fprintf(fp,"# SIZE_RESTRICTION_MAXIMUM: %d\n",prob->size_restriction_maximum);
+    fprintf(fp,"# PREPROCESSING: %d\n",run->prepro!=NULL);
+    if(run->prepro!=NULL){
+        fprintf(fp,"# PREPROCESSING_FIXED_FACILITIES: %d\n",run->prepro->n_fixed);
+        fprintf(fp,"# PREPROCESSING_CLOSED_FACILITIES: %d\n",run->prepro->n_closed);
+        fprintf(fp,"# PREPROCESSING_MERGED_CLIENTS: %d\n",run->prepro->n_merged);
+        fprintf(fp,"# REDUCED_N_FACILITIES: %d\n",run->prob->n_facs);
+        fprintf(fp,"# REDUCED_N_CLIENTS: %d\n",run->prob->n_clis);
+    }
     fprintf(fp,"\n");
     fprintf(fp,"== RUN DATA ==\n");
     fprintf(fp,"# FILTER: %s (%d)\n",filter_names[run->filter],(int)run->filter);
@@ -91,13 +163,32 @@ void rundata_print(const rundata *run, FILE *fp){
     fprintf(fp,"# LOCAL_SEARCH_BEFORE_SELECT: %d\n",run->local_search_before_select);
     fprintf(fp,"# LOCAL_SEARCH_REM_MOVEMENT: %d\n",run->local_search_rem_movement);
     fprintf(fp,"# LOCAL_SEARCH_ADD_MOVEMENT: %d\n",run->local_search_add_movement);
+    fprintf(fp,"# LOCAL_SEARCH_MEMO: %d\n",run->ls_memo!=NULL);
+    fprintf(fp,"# DELTA_SOLUTIONS: %d\n",run->delta_solutions);
+    fprintf(fp,"# INITIAL_SOLUTIONS: %d\n",run->n_init_sols);
+    fprintf(fp,"# INITIAL_LOCAL_SEARCH: %d\n",run->init_local_search);
+    fprintf(fp,"# INITIAL_START: %d\n",run->init_start);
     fprintf(fp,"# BRANCHING_FACTOR: %d\n",run->branching_factor);
     fprintf(fp,"# BRANCHING_FACTOR_CORRECTION: %d\n",run->branching_correction);
     fprintf(fp,"# PATH_RELINKING: %s\n",path_relinking_names[run->path_relinking]);
     fprintf(fp,"# PATH_RELINKING_LOCAL_SEARCH: %s\n",local_search_names[run->local_search_pr]);
+    fprintf(fp,"# PATH_RELINKING_PARTNERS: %d\n",run->pr_partners);
+    fprintf(fp,"# PATH_RELINKING_TRUNCATE: %lf\n",run->pr_truncate);
+    fprintf(fp,"# PATH_RELINKING_ROUND_ROBIN: %d\n",run->pr_round_robin);
     fprintf(fp,"# RANDOM_SEED: %d\n",run->random_seed);
     fprintf(fp,"# RESTARTS: %d\n",run->n_restarts);
+    fprintf(fp,"# PARALLEL_RESTARTS: %d\n",run->parallel_restarts);
+    fprintf(fp,"# TIME_LIMIT: %lf (%s)\n",run->time_limit,run->time_limit_cpu? "CPU" : "ELAPSED");
+    fprintf(fp,"# CHECKPOINT_INTERVAL: %lf\n",run->checkpoint_interval);
     fprintf(fp,"# VERBOSE: %d\n",run->verbose);
-    fprintf(fp,"# BRANCH_AND_BOUND: %d (deprecated)\n",run->branch_and_bound);
+    fprintf(fp,"# OUTPUT_CSV: %d\n",run->output_csv);
+    fprintf(fp,"# PROFILER: %d\n",run->prof!=NULL);
+    fprintf(fp,"# PERF_COUNTERS: %d\n",run->prof!=NULL && run->prof->perf!=NULL);
+    fprintf(fp,"# BRANCH_AND_BOUND: %d\n",run->branch_and_bound);
     fprintf(fp,"# LOWER_BOUND: %lf \n",run->bnb_lower_bound);
 }
+
+int rundata_original_n_clis(const rundata *run){
+    if(run->prepro!=NULL) return run->prepro->orig->n_clis;
+    return run->prob->n_clis;
+}
@@ -5,6 +5,9 @@
 #include "runinfo.h"
 #include "runprecomp.h"
 
+#include <time.h>
+#include <sys/time.h>
+
 #define MAX_FILTER 4
 
 #define DEFAULT_TARGET_SOLS 1
@@ -15,6 +18,10 @@
 #define BRANCH_AND_BOUND_DEFAULT 0
 #define DEFAULT_LOCAL_SEARCH_BEFORE_SELECT 1
 #define DEFAULT_SELECT_ONLY_TERMINAL 1
+#define DEFAULT_PARALLEL_RESTARTS 0
+#define DEFAULT_TIME_LIMIT 0
+#define DEFAULT_CHECKPOINT_INTERVAL 0
+#define DEFAULT_LS_MEMO_SIZE (1<<20)
 
 // Possible filters after child solutions are created
 typedef enum {
@@ -46,17 +53,33 @@ typedef enum {
 
 #define DEFAULT_PATH_RELINKING NO_PATH_RELINKING
 
+// Memo of the local searches already performed (see lsmemo.h)
+typedef struct lsmemo lsmemo;
+// Dual bounds for branch and bound (see dualbound.h)
+typedef struct dualbound dualbound;
+// Reduction of the problem before the search (see preprocess.h)
+typedef struct preprocessing preprocessing;
+// Phase profiler (see profiler.h)
+typedef struct profiler profiler;
+// Callbacks of a program that embeds the solver (see below)
+typedef struct runcallbacks runcallbacks;
+// Solution (see solution.h)
+struct solution;
 
 
 typedef struct {
     // The current problem being solved
     problem *prob;
+    // | Preprocessing that reduced the original problem into prob (NULL if it wasn't performed)
+    preprocessing *prepro;
     // | Filter used after expanding the current solutions.
     filter filter;
     // | If B&B is active
     int branch_and_bound;
     // | Lower bound for the optimal cost (for B&B)
     double bnb_lower_bound;
+    // | Dual bounds used to prune solutions on B&B (NULL if not computed)
+    dualbound *dual_bound;
     // | Number of solutions requested
     int target_sols;
     // | Number of threads
@@ -69,6 +92,8 @@ typedef struct {
     int random_seed;
     // | Restarts
     int n_restarts;
+    // | If restarts are distributed between the threads, instead of the phases of each restart
+    int parallel_restarts;
     // | If only terminal solutions are selected
     int select_only_terminal;
     // | If the local search is perform before final selection
@@ -77,6 +102,17 @@ typedef struct {
     int local_search_rem_movement;
     // | If the local search has the add movement
     int local_search_add_movement;
+    // | If children solutions only keep the clients reassigned from their parent's assignments
+    int delta_solutions;
+    // | Memo of local searches shared by all the generations and restarts (NULL if disabled)
+    lsmemo *ls_memo;
+    // | Initial solutions (warm start), injected on the generation of their size on each restart
+    struct solution **init_sols;
+    int n_init_sols;
+    // | If local search is applied to the initial solutions before the search
+    int init_local_search;
+    // | If the restarts start from the initial solutions of the smallest size, instead of the empty solution
+    int init_start;
     /* Maximum number of solutions that will be generated at random from each solution on the pool.
     if -1, then all solutions will be generated
     if 0, then ceil(log2(m/p)) solutions will be generated */
@@ -85,9 +121,41 @@ typedef struct {
     int branching_correction;
     // If PR is enabled
     pathrelinkingmode path_relinking;
+    // Number of most different partners that each solution is linked with (0 for all)
+    int pr_partners;
+    // Fraction of the movements of each path that are performed
+    double pr_truncate;
+    // If the pairs are assigned to the threads round robin, instead of dynamically from the most expensive ones
+    int pr_round_robin;
+
+    // | Time limit in seconds (0 for no limit), the search stops between phases when it is reached
+    double time_limit;
+    // | If the time limit is on CPU time instead of elapsed time
+    int time_limit_cpu;
+    // | File where the best solution is saved each time it improves (NULL to disable)
+    const char *anytime_fname;
+    // | Seconds between checkpoints (0 to disable them)
+    double checkpoint_interval;
+    // | File where the checkpoints are saved
+    const char *checkpoint_fname;
+    // | If the search should be resumed from the checkpoint file, when it exists
+    int resume;
+    // | Moment when the search started
+    struct timeval start_time;
+    clock_t start_clock;
 
     // | Verbose mode
     int verbose;
+    // | If the solutions are saved as CSV lines, instead of the full format
+    int output_csv;
+
+    // | Profiler of the phases (NULL if disabled)
+    profiler *prof;
+    // | Set of profiler rings where this run records its spans (0, or 1+i on the i-th restart worker with -p)
+    int prof_set;
+
+    // | Callbacks of the program that embeds the solver (NULL if none), shared by the copies of the rundata
+    runcallbacks *callbacks;
 
     // | Run info
     runinfo *run_inf;
@@ -97,14 +165,42 @@ typedef struct {
 
 } rundata;
 
-// Creates a rundata for the given problem and performs precomputations
+// Callbacks used by libdc2 (see libdc2.h)
+struct runcallbacks {
+    // | Called each time the best solution improves, with the final solutions locked (NULL if unused)
+    void (*improvement)(const rundata *run, const struct solution *sol, void *data);
+    // | Called after the reduction of each generation, with its size and number of solutions (NULL if unused).
+    // If it retrieves nonzero the search stops, as if the time limit was reached.
+    int (*progress)(const rundata *run, int restart, int size, int n_sols, void *data);
+    // | Data given to the callbacks
+    void *data;
+    // | If the search must stop
+    volatile int stop;
+};
+
+// Creates a rundata for the given problem, that is kept and freed with it, and performs precomputations
 // if precomp_nearly_indexes: Precompute, for each client facilities indexes by proximity
 rundata *rundata_init(problem *prob, redstrategy *rstrats, int n_rstrats, int n_restarts, int precomp_nearly_indexes, int n_threads, int verbose);
 
 // Free a rundata
 void rundata_free(rundata *run);
 
+// Sets the start of the search, for the time limit
+void rundata_start_timer(rundata *run);
+
+// Elapsed seconds since the start of the search
+double rundata_elapsed(const rundata *run);
+
+// Seconds since the start of the search (CPU seconds if the time limit is on CPU time)
+double rundata_seconds(const rundata *run);
+
+// Whether the time limit was reached, or the search was stopped by its callbacks
+int rundata_time_is_up(const rundata *run);
+
 // Prints a briefing of the rundata parameters
 void rundata_print(const rundata *run, FILE *fp);
 
+// Number of clients of the problem before the preprocessing, that merges them
+int rundata_original_n_clis(const rundata *run);
+
 #endif
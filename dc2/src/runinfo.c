@@ -6,9 +6,17 @@ runinfo *runinfo_init(const problem *prob, int n_restarts){
     rinf->firstr_n_iterations      = 0;
     rinf->total_n_iterations       = 0;
     rinf->n_local_searches         = 0;
+    rinf->n_bnb_pruned             = 0;
     rinf->n_local_search_movements = 0;
     rinf->local_search_seconds     = 0;
     rinf->path_relinking_seconds   = 0;
+    rinf->time_limit_reached       = 0;
+
+    // Improvements trace
+    rinf->n_improvements     = 0;
+    rinf->improvements_size  = 16;
+    rinf->improvement_times  = safe_malloc(sizeof(double)*rinf->improvements_size);
+    rinf->improvement_values = safe_malloc(sizeof(double)*rinf->improvements_size);
 
     // First restart data
     rinf->firstr_per_size_n_sols = safe_malloc(sizeof(int)*(prob->n_facs+2));
@@ -37,6 +45,20 @@ void runinfo_free(runinfo *rinf){
     // Free restart data
     free(rinf->restart_times);
     free(rinf->restart_values);
+    // Free improvements trace
+    free(rinf->improvement_times);
+    free(rinf->improvement_values);
     //
     free(rinf);
 }
+
+void runinfo_add_improvement(runinfo *rinf, double seconds, double value){
+    if(rinf->n_improvements==rinf->improvements_size){
+        rinf->improvements_size *= 2;
+        rinf->improvement_times  = safe_realloc(rinf->improvement_times,sizeof(double)*rinf->improvements_size);
+        rinf->improvement_values = safe_realloc(rinf->improvement_values,sizeof(double)*rinf->improvements_size);
+    }
+    rinf->improvement_times[rinf->n_improvements]  = seconds;
+    rinf->improvement_values[rinf->n_improvements] = value;
+    rinf->n_improvements += 1;
+}
@@ -26,9 +26,21 @@ typedef struct {
     double *restart_values;
     // | CPU time performing path relinking:
     double path_relinking_seconds;
+    // | Number of solutions pruned by branch and bound
+    long long int n_bnb_pruned;
+    // | If the search was stopped by the time limit
+    int time_limit_reached;
+    // | Improvements of the best solution: seconds since the start and new value
+    int n_improvements;
+    int improvements_size;
+    double *improvement_times;
+    double *improvement_values;
 } runinfo;
 
 runinfo *runinfo_init(const problem *prob, int n_restarts);
 void runinfo_free(runinfo *rinf);
 
+// Records that the best solution found improved to the given value
+void runinfo_add_improvement(runinfo *rinf, double seconds, double value);
+
 #endif
@@ -13,29 +13,38 @@ typedef struct {
     int mode;
 } precomp_facs_dist_thread_args;
 
+// Computes the distance between facilities a and b acording to mode, without considering the client skip (-1 for none)
+double precomp_facs_dist(const problem *prob, int mode, int a, int b, int skip){
+    double dist = 0;
+    if(mode==FACDIS_SUM_OF_DELTAS){
+        dist = 0;
+        for(int j=0;j<prob->n_clis;j++){
+            if(j==skip) continue;
+            double delta = problem_assig_value(prob,a,j) - problem_assig_value(prob,b,j);
+            if(delta<0) delta = -delta;
+            dist += delta;
+        }
+    }else if(mode==FACDIS_MIN_TRIANGLE){
+        // The costs of merged clients are multiplied by their weight, the triangle is the one of a single client
+        dist = INFINITY;
+        for(int j=0;j<prob->n_clis;j++){
+            if(j==skip) continue;
+            double dist_sum = (prob->distance_cost[a][j]+prob->distance_cost[b][j])/prob->client_weight[j];
+            if(dist_sum<dist) dist = dist_sum;
+        }
+    }else{
+        assert(!"Asked to precompute valid facility distance.");
+    }
+    return dist;
+}
+
 void *precomp_facs_dist_thread_execution(void *arg){
     precomp_facs_dist_thread_args *args = (precomp_facs_dist_thread_args *) arg;
     const problem *prob = args->prob;
     // Compute facility-facility distances acording to mode
     for(int a=args->thread_id;a<prob->n_facs;a+=args->n_threads){
         for(int b=a;b<prob->n_facs;b++){
-            double dist = 0;
-            if(args->mode==FACDIS_SUM_OF_DELTAS){
-                dist = 0;
-                for(int j=0;j<prob->n_clis;j++){
-                    double delta = problem_assig_value(prob,a,j) - problem_assig_value(prob,b,j);
-                    if(delta<0) delta = -delta;
-                    dist += delta;
-                }
-            }else if(args->mode==FACDIS_MIN_TRIANGLE){
-                dist = INFINITY;
-                for(int j=0;j<prob->n_clis;j++){
-                    double dist_sum = prob->distance_cost[a][j]+prob->distance_cost[b][j];
-                    if(dist_sum<dist) dist = dist_sum;
-                }
-            }else{
-                assert(!"Asked to precompute valid facility distance.");
-            }
+            double dist = precomp_facs_dist(prob,args->mode,a,b,-1);
             args->pcomp->facs_distance[args->mode][a][b] = dist;
             args->pcomp->facs_distance[args->mode][b][a] = dist;
         }
@@ -69,32 +78,44 @@ int distpair_cmp(const void *a,const void *b){
     return 1;
 }
 
+// Computes the facility indexes sorted by proximity to client i
+void precomp_client_nearly_indexes(runprecomp *pcomp, const problem *prob, int i){
+    // Initialize array of distpairs with distances and facility indexes
+    distpair *pairs = safe_malloc(sizeof(distpair)*prob->n_facs);
+    for(int f=0;f<prob->n_facs;f++){
+        pairs[f].value = problem_assig_value(prob,f,i);
+        pairs[f].indx = f;
+    }
+    // Sort pairs by distance
+    qsort(pairs,prob->n_facs,sizeof(distpair),distpair_cmp);
+    assert(prob->n_facs==0 || pairs[0].value >= pairs[prob->n_facs-1].value);
+    // Initialize nearly indexes list
+    for(int k=0;k<prob->n_facs;k++){
+        pcomp->nearly_indexes[i][k] = pairs[k].indx;
+    }
+    assert(prob->n_facs==0 || problem_assig_value(prob,pcomp->nearly_indexes[i][0],i) >= problem_assig_value(prob,pcomp->nearly_indexes[i][prob->n_facs-1],i));
+    // Free pairs data structure
+    free(pairs);
+}
+
 void *precomp_nearly_indexes_thread_execution(void *arg){
     precomp_nearly_indexes_args *args = (precomp_nearly_indexes_args *) arg;
-    const problem *prob = args->prob;
-    runprecomp *pcomp = args->pcomp;
     // Compute facility indexes sorted by proximity, client-wise.
-    for(int i=args->thread_id;i<prob->n_clis;i+=args->n_threads){
-        // Initialize array of distpairs with distances and facility indexes
-        distpair *pairs = safe_malloc(sizeof(distpair)*prob->n_facs);
-        for(int f=0;f<prob->n_facs;f++){
-            pairs[f].value = problem_assig_value(prob,f,i);
-            pairs[f].indx = f;
-        }
-        // Sort pairs by distance
-        qsort(pairs,prob->n_facs,sizeof(distpair),distpair_cmp);
-        assert(prob->n_facs==0 || pairs[0].value >= pairs[prob->n_facs-1].value);
-        // Initialize nearly indexes list
-        for(int k=0;k<prob->n_facs;k++){
-            pcomp->nearly_indexes[i][k] = pairs[k].indx;
-        }
-        assert(prob->n_facs==0 || problem_assig_value(prob,pcomp->nearly_indexes[i][0],i) >= problem_assig_value(prob,pcomp->nearly_indexes[i][prob->n_facs-1],i));
-        // Free pairs data structure
-        free(pairs);
+    for(int i=args->thread_id;i<args->prob->n_clis;i+=args->n_threads){
+        precomp_client_nearly_indexes(args->pcomp,args->prob,i);
     }
     return NULL;
 }
 
+// Optimal value of a client with the given costs for each facility, the unassigned cost is the one of the problem
+double precomp_client_optimal_value(const problem *prob, int c, const double *costs){
+    double best_val = problem_assig_value(prob,-1,c);
+    for(int i=0;i<prob->n_facs;i++){
+        if(best_val < -costs[i]) best_val = -costs[i];
+    }
+    return best_val;
+}
+
 // ============================================================================
 
 runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rstrats, int precomp_nearly_indexes, int n_threads, int verbose){
@@ -222,3 +243,74 @@ void runprecomp_free(runprecomp *pcomp){
     // Free the precomputation
     free(pcomp);
 }
+
+void runprecomp_update_client(runprecomp *pcomp, const problem *prob, int c, const double *old_costs){
+    int m = prob->n_facs;
+    // Current costs of the client
+    double *costs = safe_malloc(sizeof(double)*(m+1));
+    for(int i=0;i<m;i++) costs[i] = prob->distance_cost[i][c];
+    if(old_costs==NULL){
+        // A new client, add its nearly indexes
+        assert(c==pcomp->n_clis);
+        pcomp->n_clis += 1;
+        if(pcomp->nearly_indexes){
+            pcomp->nearly_indexes = safe_realloc(pcomp->nearly_indexes,sizeof(int*)*pcomp->n_clis);
+            pcomp->nearly_indexes[c] = safe_malloc(sizeof(int)*m);
+        }
+    }
+    // Update client optimal gain
+    pcomp->precomp_client_optimal_gain += precomp_client_optimal_value(prob,c,costs);
+    if(old_costs!=NULL) pcomp->precomp_client_optimal_gain -= precomp_client_optimal_value(prob,c,old_costs);
+    // Update facility-facility distances with the contribution of the client
+    double w = prob->client_weight[c];
+    for(int mode=0;mode<N_FACDIS_MODES;mode++){
+        double **dist = pcomp->facs_distance[mode];
+        if(dist==NULL) continue;
+        for(int a=0;a<m;a++){
+            for(int b=a;b<m;b++){
+                if(mode==FACDIS_SUM_OF_DELTAS){
+                    dist[a][b] += fabs(costs[a]-costs[b]);
+                    if(old_costs!=NULL) dist[a][b] -= fabs(old_costs[a]-old_costs[b]);
+                }else if(old_costs!=NULL && (old_costs[a]+old_costs[b])/w<=dist[a][b] && (costs[a]+costs[b])/w>dist[a][b]){
+                    // The client was the one with the minimum, that has to be found again
+                    dist[a][b] = precomp_facs_dist(prob,mode,a,b,-1);
+                }else if((costs[a]+costs[b])/w<dist[a][b]){
+                    dist[a][b] = (costs[a]+costs[b])/w;
+                }
+                dist[b][a] = dist[a][b];
+            }
+        }
+    }
+    // Update the nearly indexes of the client
+    if(pcomp->nearly_indexes) precomp_client_nearly_indexes(pcomp,prob,c);
+    free(costs);
+}
+
+void runprecomp_remove_client(runprecomp *pcomp, const problem *prob, int c){
+    int m = prob->n_facs;
+    double *costs = safe_malloc(sizeof(double)*(m+1));
+    for(int i=0;i<m;i++) costs[i] = prob->distance_cost[i][c];
+    // Remove the contributions of the client
+    pcomp->precomp_client_optimal_gain -= precomp_client_optimal_value(prob,c,costs);
+    for(int mode=0;mode<N_FACDIS_MODES;mode++){
+        double **dist = pcomp->facs_distance[mode];
+        if(dist==NULL) continue;
+        for(int a=0;a<m;a++){
+            for(int b=a;b<m;b++){
+                if(mode==FACDIS_SUM_OF_DELTAS){
+                    dist[a][b] -= fabs(costs[a]-costs[b]);
+                }else if((costs[a]+costs[b])/prob->client_weight[c]<=dist[a][b]){
+                    dist[a][b] = precomp_facs_dist(prob,mode,a,b,c);
+                }
+                dist[b][a] = dist[a][b];
+            }
+        }
+    }
+    // The last client takes the index of the removed one
+    if(pcomp->nearly_indexes){
+        free(pcomp->nearly_indexes[c]);
+        pcomp->nearly_indexes[c] = pcomp->nearly_indexes[pcomp->n_clis-1];
+    }
+    pcomp->n_clis -= 1;
+    free(costs);
+}
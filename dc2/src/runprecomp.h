@@ -17,6 +17,13 @@ typedef struct {
 
 runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rstrats, int precomp_nearly_indexes, int n_threads, int verbose);
 
+// Updates the precomputations after the costs of client c changed, given its previous costs for each facility
+// (NULL if it is a new client, added at the end).
+void runprecomp_update_client(runprecomp *pcomp, const problem *prob, int c, const double *old_costs);
+
+// Updates the precomputations before the client c is removed from the problem (the last client takes its index).
+void runprecomp_remove_client(runprecomp *pcomp, const problem *prob, int c);
+
 void runprecomp_free(runprecomp *pcomp);
 
 #endif
@@ -5,22 +5,45 @@
 #define RANXOSHI256_IMPLEMENTATION
 #include "lib/ranxoshi256.h"
 
+void rngen_seed(ranxoshi256 *rngen, unsigned long long seed){
+    unsigned char bytes[32];
+    uint64_t x = seed;
+    for(int i=0;i<4;i++){
+        // splitmix64 step
+        x += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = x;
+        z = (z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+        z = (z^(z>>27))*0x94D049BB133111EBULL;
+        z = z^(z>>31);
+        for(int b=0;b<8;b++) bytes[i*8+b] = (unsigned char)(z>>(8*(7-b)));
+    }
+    ranxoshi256Seed(rngen,bytes);
+}
+
+void rngen_seed_stream(ranxoshi256 *rngen, unsigned long long seed, unsigned long long stream){
+    // Mix the stream so that consecutive streams lead to unrelated seeds
+    ranxoshi256 mixer;
+    rngen_seed(&mixer,stream);
+    rngen_seed(rngen,seed^ranxoshi256Next(&mixer));
+}
 
 shuffler *shuffler_init(int len){
     // Allocate memory and initialize numbers
     shuffler *shu = safe_malloc(sizeof(shuffler));
     shu->len = len;
     shu->nums = safe_malloc(sizeof(unsigned int)*shu->len);
-    for(int i=0;i<len;i++) shu->nums[i] = i;
+    shuffler_seed(shu,0,0);
+    return shu;
+}
+
+void shuffler_seed(shuffler *shu, unsigned long long seed, unsigned long long stream){
+    // Restore the numbers, so the previous shuffles don't matter
+    for(int i=0;i<shu->len;i++) shu->nums[i] = i;
     // Initialize random number generator
-    unsigned char seed[32];
-    for(int i=0;i<32;i++) seed[i] = rand()%256;
-    ranxoshi256Seed(&shu->rngen,seed);
+    rngen_seed_stream(&shu->rngen,seed,stream);
     // First shuffler, shuffler everything
     shu->n_retrieved = shu->len;
     shuffler_reshuffle(shu);
-    //
-    return shu;
 }
 
 unsigned int shuffler_next(shuffler *shu){
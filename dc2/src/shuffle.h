@@ -9,6 +9,17 @@
 
 typedef struct ranxoshi256 ranxoshi256;
 
+// Seeds a random number generator from an integer seed, expanding it with splitmix64
+void rngen_seed(ranxoshi256 *rngen, unsigned long long seed);
+
+// Seeds a random number generator for the given stream, different streams are independent
+void rngen_seed_stream(ranxoshi256 *rngen, unsigned long long seed, unsigned long long stream);
+
+// Gets a random integer in [0,n)
+static inline unsigned int rngen_below(ranxoshi256 *rngen, unsigned int n){
+    return (unsigned int)(ranxoshi256Next(rngen)%n);
+}
+
 typedef struct {
     int len;
     unsigned int *nums;
@@ -17,8 +28,13 @@ typedef struct {
 } shuffler;
 
 // Initializes a random shuffler generator that retrieves numbers from 0 len-1
+// It starts on the stream 0 of the seed 0, use shuffler_seed to pick another one.
 shuffler *shuffler_init(int len);
 
+// Restarts the shuffler on the given stream of the seed, so the numbers that it retrieves
+// only depend on them and not on its previous use (e.g. the thread that runs a task).
+void shuffler_seed(shuffler *shu, unsigned long long seed, unsigned long long stream);
+
 // Gets the next shuffled number
 unsigned int shuffler_next(shuffler *shu);
 
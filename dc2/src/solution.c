@@ -14,6 +14,8 @@ int solutionp_facs_cmp(const void *a, const void *b){
     const solution **bb = (const solution **) b;
     const solution *sol1 = *aa;
     const solution *sol2 = *bb;
+    if(sol1->hash>sol2->hash) return +1;
+    if(sol1->hash<sol2->hash) return -1;
     int d = sol1->n_facs - sol2->n_facs;
     if(d!=0) return d;
     for(int i=0;i<sol1->n_facs;i++){
@@ -37,6 +39,12 @@ solution *solution_empty(const problem *prob){
         sol->value += problem_assig_value(prob,-1,j);
     }
     sol->terminal = 0;
+    sol->hash = 0;
+    sol->refs = 1;
+    sol->parent = NULL;
+    sol->n_delta = 0;
+    sol->delta = NULL;
+    sol->delta_fac = -1;
     return sol;
 }
 
@@ -46,12 +54,87 @@ solution *solution_copy(const problem *prob, const solution *sol){
     sol2->facs =    safe_malloc(sizeof(int)*sol->n_facs);
     memcpy(sol2->facs,sol->facs,sizeof(int)*sol->n_facs);
     sol2->assigns = safe_malloc(sizeof(int)*prob->n_clis);
-    memcpy(sol2->assigns,sol->assigns,sizeof(int)*prob->n_clis);
+    solution_get_assigns(prob,sol,sol2->assigns);
     sol2->value = sol->value;
     sol2->terminal = sol->terminal;
+    sol2->hash = sol->hash;
+    sol2->refs = 1;
+    sol2->parent = NULL;
+    sol2->n_delta = 0;
+    sol2->delta = NULL;
+    sol2->delta_fac = -1;
     return sol2;
 }
 
+solution *solution_child(const problem *prob, solution *parent, int newf, int *buffer){
+    int *assigns = buffer;
+    int *moved = &buffer[prob->n_clis];
+    solution_get_assigns(prob,parent,assigns);
+    solution *sol = safe_malloc(sizeof(solution));
+    sol->n_facs = parent->n_facs;
+    sol->facs = safe_malloc(sizeof(int)*(parent->n_facs+1));
+    memcpy(sol->facs,parent->facs,sizeof(int)*parent->n_facs);
+    add_to_sorted(sol->facs,&sol->n_facs,newf);
+    sol->hash = parent->hash ^ zobrist_key(newf);
+    sol->terminal = 0;
+    // Find the clients reassigned to the new facility, the value is computed as in solution_add
+    int n_moved = 0;
+    double value2 = 0;
+    for(int c=0;c<prob->n_clis;c++){
+        double val_pre = problem_assig_value(prob,assigns[c],c);
+        double val_pos = problem_assig_value(prob,newf,c);
+        if(val_pos>val_pre){
+            moved[n_moved++] = c;
+            value2 += val_pos;
+        }else{
+            value2 += val_pre;
+        }
+    }
+    for(int i=0;i<sol->n_facs;i++){
+        value2 -= prob->facility_cost[sol->facs[i]];
+    }
+    sol->value = value2;
+    // Share the assignments of the parent
+    sol->assigns = NULL;
+    sol->n_delta = n_moved;
+    sol->delta = safe_malloc(sizeof(int)*(n_moved+1));
+    memcpy(sol->delta,moved,sizeof(int)*n_moved);
+    sol->delta_fac = newf;
+    sol->refs = 1;
+    sol->parent = parent;
+    __atomic_add_fetch(&parent->refs,1,__ATOMIC_RELAXED);
+    return sol;
+}
+
+void solution_get_assigns(const problem *prob, const solution *sol, int *assigns){
+    if(sol->assigns!=NULL){
+        memcpy(assigns,sol->assigns,sizeof(int)*prob->n_clis);
+        return;
+    }
+    solution_get_assigns(prob,sol->parent,assigns);
+    for(int k=0;k<sol->n_delta;k++) assigns[sol->delta[k]] = sol->delta_fac;
+}
+
+void solution_make_writable(const problem *prob, solution **solp){
+    solution *sol = *solp;
+    if(sol->refs>1){
+        // Children depend on the solution, so it is replaced by a copy
+        *solp = solution_copy(prob,sol);
+        solution_free(sol);
+    }else if(sol->assigns==NULL){
+        // Take the assignments of the parent, and release it
+        int *assigns = safe_malloc(sizeof(int)*prob->n_clis);
+        solution_get_assigns(prob,sol,assigns);
+        sol->assigns = assigns;
+        free(sol->delta);
+        sol->delta = NULL;
+        sol->n_delta = 0;
+        sol->delta_fac = -1;
+        solution_free(sol->parent);
+        sol->parent = NULL;
+    }
+}
+
 void solution_add(const problem *prob, solution *sol, int newf, int *affected){
     // Check if f is already on the solution:
     for(int f=0;f<sol->n_facs;f++){
@@ -59,10 +142,14 @@ void solution_add(const problem *prob, solution *sol, int newf, int *affected){
             return;
         }
     }
+    #ifdef DEBUG
+        assert(sol->assigns!=NULL && sol->refs==1);
+    #endif
     // Extend array of facilities
     sol->facs = safe_realloc(sol->facs,sizeof(int)*(sol->n_facs+1));
     // Add facility to the solution
     add_to_sorted(sol->facs,&sol->n_facs,newf);
+    sol->hash ^= zobrist_key(newf);
     // | New value after adding the new facility.
     double value2 = 0;
     // Reassign clients to the new instalation
@@ -85,7 +172,11 @@ void solution_add(const problem *prob, solution *sol, int newf, int *affected){
 }
 
 void solution_remove(const problem *prob, solution *sol, int remf, int *phi2, int *affected){
+    #ifdef DEBUG
+        assert(sol->assigns!=NULL && sol->refs==1);
+    #endif
     rem_of_sorted(sol->facs,&sol->n_facs,remf);
+    sol->hash ^= zobrist_key(remf);
     // New value after adding the new facility
     double value2 = 0;
     // Drop clients of the facility.
@@ -127,18 +218,23 @@ void solution_remove(const problem *prob, solution *sol, int remf, int *phi2, in
 }
 
 void solution_free(solution *sol){
+    // Keep the solution while delta children depend on it
+    if(__atomic_sub_fetch(&sol->refs,1,__ATOMIC_ACQ_REL)>0) return;
+    solution *parent = sol->parent;
     free(sol->facs);
     free(sol->assigns);
+    free(sol->delta);
     free(sol);
+    if(parent!=NULL) solution_free(parent);
 }
 
 // Compute the distance between two solutions
 double solution_dissimilitude(const rundata *run,
         const solution *sol1, const solution *sol2,
         soldismode sdismode, facdismode fdismode){
-    // The auto case picks the sdismode
+    // The auto case picks the sdismode, with the clients before merging them, as the cost of each mode does
     if(sdismode==SOLDIS_AUTO){
-        if(sol1->n_facs*sol2->n_facs <= 15*run->prob->n_clis){
+        if(sol1->n_facs*sol2->n_facs <= 15*rundata_original_n_clis(run)){
             sdismode = SOLDIS_MEAN_GEOMETRIC_ERROR;
         }else{
             sdismode = SOLDIS_PER_CLIENT_DELTA;
@@ -230,14 +326,31 @@ double solution_dissimilitude(const rundata *run,
         return disim;
     }
     else if(sdismode==SOLDIS_PER_CLIENT_DELTA){
+        // Retrieve the assignments of delta solutions
+        const int *assigns1 = sol1->assigns;
+        const int *assigns2 = sol2->assigns;
+        int *buffer1 = NULL;
+        int *buffer2 = NULL;
+        if(assigns1==NULL){
+            buffer1 = safe_malloc(sizeof(int)*run->prob->n_clis);
+            solution_get_assigns(run->prob,sol1,buffer1);
+            assigns1 = buffer1;
+        }
+        if(assigns2==NULL){
+            buffer2 = safe_malloc(sizeof(int)*run->prob->n_clis);
+            solution_get_assigns(run->prob,sol2,buffer2);
+            assigns2 = buffer2;
+        }
         double total = 0;
         for(int i=0;i<run->prob->n_clis;i++){
-            double cost_a = problem_assig_value(run->prob,sol1->assigns[i],i);
-            double cost_b = problem_assig_value(run->prob,sol2->assigns[i],i);
+            double cost_a = problem_assig_value(run->prob,assigns1[i],i);
+            double cost_b = problem_assig_value(run->prob,assigns2[i],i);
             double delta = cost_a-cost_b;
             if(delta<0) delta = -delta;
             total += delta;
         }
+        free(buffer1);
+        free(buffer2);
         return total;
     }else if(sdismode==SOLDIS_INDEXES_VALUE){
         int delta = diff_sorted(sol1->facs,sol1->n_facs,sol2->facs,sol2->n_facs);
@@ -261,9 +374,8 @@ double solution_upper_bound(const rundata *run, const solution *sol){
     return upbound;
 }
 
-int solution_client_2nd_nearest(const problem *prob, const solution *sol, int cli){
-    // Nearest facility
-    int phi1 = sol->assigns[cli];
+// Find the index of the second nearest facility to the given client, given the nearest one
+int client_2nd_nearest(const problem *prob, const solution *sol, int cli, int phi1){
     // 2nd nearest
     int phi2 = -1;
     double phi2_assig_cost = problem_assig_cost(prob,phi2,cli);
@@ -280,6 +392,58 @@ int solution_client_2nd_nearest(const problem *prob, const solution *sol, int cl
     return phi2;
 }
 
+int solution_client_2nd_nearest(const problem *prob, const solution *sol, int cli){
+    return client_2nd_nearest(prob,sol,cli,sol->assigns[cli]);
+}
+
+void solution_compute_phi1_and_phi2(const problem *prob, const solution *sol, int *phi1, int *phi2){
+    solution_get_assigns(prob,sol,phi1);
+    for(int i=0;i<prob->n_clis;i++){
+        phi2[i] = client_2nd_nearest(prob,sol,i,phi1[i]);
+    }
+}
+
+void solution_update_facility_cost(const problem *prob, solution *sol, int f, double old_cost){
+    for(int k=0;k<sol->n_facs;k++){
+        if(sol->facs[k]==f){
+            sol->value -= prob->facility_cost[f]-old_cost;
+            return;
+        }
+    }
+}
+
+void solution_update_client(const problem *prob, solution *sol, int c, const double *old_costs, int *phi1, int *phi2){
+    assert(sol->assigns!=NULL);
+    // Remove the value of the previous assignment
+    if(old_costs!=NULL){
+        int f = sol->assigns[c];
+        sol->value += f==-1? problem_assig_cost(prob,-1,c) : old_costs[f];
+    }
+    // Assign the client to its nearest facility
+    int phi1c = -1;
+    for(int k=0;k<sol->n_facs;k++){
+        int f = sol->facs[k];
+        if(problem_assig_cost(prob,f,c)<problem_assig_cost(prob,phi1c,c)) phi1c = f;
+    }
+    sol->assigns[c] = phi1c;
+    sol->value += problem_assig_value(prob,phi1c,c);
+    if(phi1!=NULL){
+        phi1[c] = phi1c;
+        phi2[c] = client_2nd_nearest(prob,sol,c,phi1c);
+    }
+}
+
+void solution_remove_client(const problem *prob, solution *sol, int c, int *phi1, int *phi2){
+    assert(sol->assigns!=NULL);
+    sol->value -= problem_assig_value(prob,sol->assigns[c],c);
+    int last = prob->n_clis-1;
+    sol->assigns[c] = sol->assigns[last];
+    if(phi1!=NULL){
+        phi1[c] = phi1[last];
+        phi2[c] = phi2[last];
+    }
+}
+
 void solution_findout(const problem *prob, const solution *sol, int f_ins, double *v,
         const int *phi2, int *frem_allowed,
         int *out_f_rem, double *out_profit, double *out_profit_worem){
@@ -328,37 +492,89 @@ void solution_findout(const problem *prob, const solution *sol, int f_ins, doubl
 }
 
 void solution_print(const problem *prob, const solution *sol, FILE *fp){
-    fprintf(fp,"== SOLUTION ==\n");
-    fprintf(fp,"# VALUE: %lf\n",sol->value);
-    fprintf(fp,"# ASSIGNS:");
+    int *assigns = safe_malloc(sizeof(int)*prob->n_clis);
+    solution_get_assigns(prob,sol,assigns);
+    dc_writer *wr = dc_writer_init(fp);
+    dc_writer_str(wr,"== SOLUTION ==\n");
+    dc_writer_str(wr,"# VALUE: ");
+    dc_writer_double(wr,sol->value);
+    dc_writer_str(wr,"\n# ASSIGNS:");
     for(int i=0;i<prob->n_clis;i++){
-        fprintf(fp," %d",sol->assigns[i]);
+        dc_writer_char(wr,' ');
+        dc_writer_int(wr,assigns[i]);
     }
-    fprintf(fp,"\n");
-    fprintf(fp,"# N_FACS: %d\n",sol->n_facs);
+    dc_writer_str(wr,"\n# N_FACS: ");
+    dc_writer_int(wr,sol->n_facs);
     //
-    fprintf(fp,"# INDEXES: ");
+    dc_writer_str(wr,"\n# INDEXES: ");
     for(int i=0;i<sol->n_facs;i++){
-        fprintf(fp,"%d ",sol->facs[i]);
+        dc_writer_int(wr,sol->facs[i]);
+        dc_writer_char(wr,' ');
+    }
+    dc_writer_char(wr,'\n');
+    // Bucket the clients by facility, in a single pass (clients stay in increasing order)
+    int *fac_pos = safe_malloc(sizeof(int)*(prob->n_facs+1));
+    for(int i=0;i<sol->n_facs;i++) fac_pos[sol->facs[i]] = i;
+    int *bucket_start = safe_malloc(sizeof(int)*(sol->n_facs+1));
+    for(int i=0;i<=sol->n_facs;i++) bucket_start[i] = 0;
+    for(int j=0;j<prob->n_clis;j++){
+        if(assigns[j]!=-1) bucket_start[fac_pos[assigns[j]]+1] += 1;
+    }
+    for(int i=0;i<sol->n_facs;i++) bucket_start[i+1] += bucket_start[i];
+    int *bucket_next = safe_malloc(sizeof(int)*(sol->n_facs+1));
+    memcpy(bucket_next,bucket_start,sizeof(int)*(sol->n_facs+1));
+    int *clients = safe_malloc(sizeof(int)*(prob->n_clis+1));
+    for(int j=0;j<prob->n_clis;j++){
+        if(assigns[j]!=-1) clients[bucket_next[fac_pos[assigns[j]]]++] = j;
     }
-    fprintf(fp,"\n");
     // Print clients for each facility
     for(int i=0;i<sol->n_facs;i++){
-        fprintf(fp,"FAC %d :",sol->facs[i]);
-        for(int j=0;j<prob->n_clis;j++){
-            if(sol->assigns[j]==sol->facs[i]){
-                fprintf(fp," %d",j);
-            }
+        dc_writer_str(wr,"FAC ");
+        dc_writer_int(wr,sol->facs[i]);
+        dc_writer_str(wr," :");
+        for(int k=bucket_start[i];k<bucket_start[i+1];k++){
+            dc_writer_char(wr,' ');
+            dc_writer_int(wr,clients[k]);
         }
-        fprintf(fp,"\n");
+        dc_writer_char(wr,'\n');
+    }
+    dc_writer_free(wr);
+    free(clients);
+    free(bucket_next);
+    free(bucket_start);
+    free(fac_pos);
+    free(assigns);
+}
+
+void solution_print_csv(const problem *prob, const solution *sol, FILE *fp){
+    int *assigns = safe_malloc(sizeof(int)*prob->n_clis);
+    solution_get_assigns(prob,sol,assigns);
+    dc_writer *wr = dc_writer_init(fp);
+    dc_writer_double(wr,sol->value);
+    dc_writer_char(wr,',');
+    dc_writer_int(wr,sol->n_facs);
+    dc_writer_char(wr,',');
+    for(int i=0;i<sol->n_facs;i++){
+        if(i>0) dc_writer_char(wr,' ');
+        dc_writer_int(wr,sol->facs[i]);
+    }
+    dc_writer_char(wr,',');
+    for(int j=0;j<prob->n_clis;j++){
+        if(j>0) dc_writer_char(wr,' ');
+        dc_writer_int(wr,assigns[j]);
     }
+    dc_writer_char(wr,'\n');
+    dc_writer_free(wr);
+    free(assigns);
 }
 
 int solution_check_integrity(const problem *prob, const solution *sol){
     int integrity = 1;
+    int *assigns = safe_malloc(sizeof(int)*prob->n_clis);
+    solution_get_assigns(prob,sol,assigns);
     // Check that each client is assigned to it's nearest facility in the solution
     for(int j=0;j<prob->n_clis;j++){
-        double current_value = problem_assig_value(prob,sol->assigns[j],j);
+        double current_value = problem_assig_value(prob,assigns[j],j);
         for(int k=0;k<sol->n_facs;k++){
             int f = sol->facs[k];
             double other_value = problem_assig_value(prob,f,j);
@@ -368,7 +584,7 @@ int solution_check_integrity(const problem *prob, const solution *sol){
     // Check that he value corresponds with the stored value
     double value = 0;
     for(int j=0;j<prob->n_clis;j++){
-        value += problem_assig_value(prob,sol->assigns[j],j);
+        value += problem_assig_value(prob,assigns[j],j);
     }
     for(int k=0;k<sol->n_facs;k++){
         int f = sol->facs[k];
@@ -379,6 +595,9 @@ int solution_check_integrity(const problem *prob, const solution *sol){
         if(error<0) error *= -1;
         if(error>=1e-5 && !isnan(error)) integrity = 0;
     }
+    // Check the hash
+    if(sol->hash!=zobrist_hash(sol->facs,sol->n_facs)) integrity = 0;
+    free(assigns);
 
     return integrity;
 }
@@ -6,23 +6,35 @@
 #include "utils.h"
 #include "rundata.h"
 
-typedef struct {
+typedef struct solution {
     int n_facs;
     // ^ Number of facilities (size) of this solution.
     int *facs;
     // ^ Indexes of the facilities. Sorted.
     int *assigns;
     // ^ For each client, which facility it is assigned to. -1 means unnasigned.
+    //   NULL if the solution is a delta of its parent, use solution_get_assigns in that case.
     double value;
     // ^ Value of the solution (> is better)
     int terminal;
     // ^ If the solution is a terminal one (didn't generate better childs).
+    uint64_t hash;
+    // ^ Zobrist hash of the facilities, updated as they are added and removed.
+    int refs;
+    // ^ References to the solution: its owner and the delta children that share its assignments.
+    struct solution *parent;
+    int n_delta;
+    int *delta;
+    int delta_fac;
+    // ^ If assigns is NULL, the solution has the assignments of parent, except for the n_delta clients
+    //   in delta (sorted), that are assigned to delta_fac.
 } solution;
 
 // solution* comparison to sort solution pointers on decreasing value
 int solutionp_value_cmp_inv(const void *a, const void *b);
 
-// solution* comparison for equality
+// solution* comparison for equality.
+// Solutions are compared by hash first, so the order is not lexicographic, but equal solutions are consecutive.
 int solutionp_facs_cmp(const void *a, const void *b);
 
 // Creates a new, empty solution.
@@ -31,6 +43,18 @@ solution *solution_empty(const problem *prob);
 // Creates a solution copying another
 solution *solution_copy(const problem *prob, const solution *sol);
 
+// Creates a child of parent adding newf, that only keeps the clients that are reassigned to newf and shares
+// the other assignments with parent. The parent is kept alive until the child is freed or made writable.
+// buffer is an auxiliary array of size 2*prob->n_clis.
+solution *solution_child(const problem *prob, solution *parent, int newf, int *buffer);
+
+// Writes the assignments of the solution, that may be shared with its parents, on the assigns array
+void solution_get_assigns(const problem *prob, const solution *sol, int *assigns);
+
+// Ensures that *solp has its own assignments and no children depend on it, so it can be modified.
+// *solp may be replaced by a copy.
+void solution_make_writable(const problem *prob, solution **solp);
+
 // Add a facility to an existing solution
 void solution_add(const problem *prob, solution *sol, int newf, int *affected);
 
@@ -42,7 +66,7 @@ void solution_remove(const problem *prob, solution *sol, int newf, int *phi2, in
 // An upper bound for the best value that a children solution could have
 double solution_upper_bound(const rundata *run, const solution *sol);
 
-// Delete solution
+// Delete solution (it is kept until the delta children that depend on it are deleted too)
 void solution_free(solution *sol);
 
 // Compute dissimilitude between solutions with the given dissimilitude mode and facility distance mode
@@ -53,6 +77,21 @@ double solution_dissimilitude(const rundata *run,
 // Find the index of the second nearest facility to the given client, on the solution
 int solution_client_2nd_nearest(const problem *prob, const solution *sol, int cli);
 
+// Computes the 1st and 2nd nearest facility on the solution for each client
+void solution_compute_phi1_and_phi2(const problem *prob, const solution *sol, int *phi1, int *phi2);
+
+// Updates the value of the solution after the cost of facility f changed from old_cost.
+void solution_update_facility_cost(const problem *prob, solution *sol, int f, double old_cost);
+
+// Updates the solution after the costs of client c changed, given its previous costs for each facility (NULL if it
+// is a new client, for which sol->assigns must have room). The client is reassigned to its nearest facility,
+// updating phi1 and phi2 unless they are NULL.
+void solution_update_client(const problem *prob, solution *sol, int c, const double *old_costs, int *phi1, int *phi2);
+
+// Updates the solution before the client c is removed from the problem (the last client takes its index),
+// along with phi1 and phi2 unless they are NULL.
+void solution_remove_client(const problem *prob, solution *sol, int c, int *phi1, int *phi2);
+
 // Find the best option for removal if f_ins is inserted to the solution
 // NOTE: v must be intialized with -INFINITY and have size equal to prob->n_facs.
 // ^ It is always reset to that state before returning.
@@ -68,6 +107,9 @@ void solution_findout(const problem *prob, const solution *sol, int f_ins, doubl
 // Print a solution to the given descriptor
 void solution_print(const problem *prob, const solution *sol, FILE *fp);
 
+// Print a solution as a single CSV line: value,n_facs,indexes,assigns (the lists separated by spaces)
+void solution_print_csv(const problem *prob, const solution *sol, FILE *fp);
+
 // Checks that has solution is properly computed, the value is right and each client is assigned to its nearest facilty
 int solution_check_integrity(const problem *prob, const solution *sol);
 
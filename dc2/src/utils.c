@@ -28,6 +28,20 @@ uint hash_int(uint x){
     return x;
 }
 
+uint64_t zobrist_key(int f){
+    // splitmix64 of the facility index, so no table has to be kept
+    uint64_t z = (uint64_t)f*0x9e3779b97f4a7c15ULL + 0x9e3779b97f4a7c15ULL;
+    z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+    z = (z^(z>>27))*0x94d049bb133111ebULL;
+    return z^(z>>31);
+}
+
+uint64_t zobrist_hash(const int *arr, int len){
+    uint64_t hash = 0;
+    for(int i=0;i<len;i++) hash ^= zobrist_key(arr[i]);
+    return hash;
+}
+
 void add_to_sorted(int *array, int *len, int val){
     int place = *len;
     while(place>0){
@@ -87,7 +101,7 @@ int diff_sorted(int *arr1, int len1, int *arr2, int len2){
             i2 += 1;
         }
     }
-    diff += (i1<i2)? i2-i1 : i1-i2;
+    diff += (len1-i1)+(len2-i2);
     return diff;
 }
 
@@ -137,6 +151,88 @@ void dc_semaphore_free(sem_t *sem){
     assert(errno==0);
 }
 
+dc_barrier *dc_barrier_init(int n_threads){
+    dc_barrier *bar = safe_malloc(sizeof(dc_barrier));
+    pthread_mutex_init(&bar->mutex,NULL);
+    pthread_cond_init(&bar->cond,NULL);
+    bar->n_threads = n_threads;
+    bar->n_waiting = 0;
+    bar->cycle = 0;
+    return bar;
+}
+
+void dc_barrier_wait(dc_barrier *bar){
+    pthread_mutex_lock(&bar->mutex);
+    int cycle = bar->cycle;
+    bar->n_waiting += 1;
+    if(bar->n_waiting==bar->n_threads){
+        // Last thread to arrive releases the others
+        bar->n_waiting = 0;
+        bar->cycle += 1;
+        pthread_cond_broadcast(&bar->cond);
+    }else{
+        while(cycle==bar->cycle) pthread_cond_wait(&bar->cond,&bar->mutex);
+    }
+    pthread_mutex_unlock(&bar->mutex);
+}
+
+void dc_barrier_free(dc_barrier *bar){
+    pthread_cond_destroy(&bar->cond);
+    pthread_mutex_destroy(&bar->mutex);
+    free(bar);
+}
+
+dc_writer *dc_writer_init(FILE *fp){
+    dc_writer *wr = safe_malloc(sizeof(dc_writer));
+    wr->fp = fp;
+    wr->buf = safe_malloc(DC_WRITER_SIZE);
+    wr->len = 0;
+    return wr;
+}
+
+static void dc_writer_flush(dc_writer *wr){
+    fwrite(wr->buf,1,wr->len,wr->fp);
+    wr->len = 0;
+}
+
+void dc_writer_str(dc_writer *wr, const char *str){
+    while(*str!='\0'){
+        if(wr->len==DC_WRITER_SIZE) dc_writer_flush(wr);
+        wr->buf[wr->len++] = *str++;
+    }
+}
+
+void dc_writer_char(dc_writer *wr, char c){
+    if(wr->len==DC_WRITER_SIZE) dc_writer_flush(wr);
+    wr->buf[wr->len++] = c;
+}
+
+void dc_writer_int(dc_writer *wr, int x){
+    // Enough space for any int
+    if(wr->len+12>DC_WRITER_SIZE) dc_writer_flush(wr);
+    unsigned int ux = x<0? -(unsigned int)x : (unsigned int)x;
+    if(x<0) wr->buf[wr->len++] = '-';
+    char digits[12];
+    int n_digits = 0;
+    do{
+        digits[n_digits++] = '0'+ux%10;
+        ux /= 10;
+    }while(ux>0);
+    while(n_digits>0) wr->buf[wr->len++] = digits[--n_digits];
+}
+
+void dc_writer_double(dc_writer *wr, double x){
+    char str[400];
+    snprintf(str,sizeof(str),"%lf",x);
+    dc_writer_str(wr,str);
+}
+
+void dc_writer_free(dc_writer *wr){
+    dc_writer_flush(wr);
+    free(wr->buf);
+    free(wr);
+}
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include <pthread.h>
 #include <semaphore.h>
@@ -29,6 +30,10 @@ void *safe_malloc(size_t size);
 void *safe_realloc(void *original, size_t size);
 
 uint hash_int(uint x);
+// Random 64-bit key of a facility, the Zobrist hash of a set of facilities is the xor of their keys
+uint64_t zobrist_key(int f);
+// Zobrist hash of an array of facilities; in O(len) time
+uint64_t zobrist_hash(const int *arr, int len);
 void add_to_sorted(int *array, int *len, int val);
 void rem_of_sorted(int *array, int *len, int val);
 int elem_in_sorted(int *array, int len, int val);
@@ -41,6 +46,44 @@ sem_t *dc_semaphore_init();
 // Semaphore destruction
 void dc_semaphore_free(sem_t *sem);
 
+// Reusable barrier for a fixed number of threads (pthread_barrier_t is not available on OS X)
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int n_threads;
+    int n_waiting;
+    int cycle;
+} dc_barrier;
+
+// Barrier initialization
+dc_barrier *dc_barrier_init(int n_threads);
+// Wait until all the threads reach the barrier
+void dc_barrier_wait(dc_barrier *bar);
+// Barrier destruction
+void dc_barrier_free(dc_barrier *bar);
+
+// Buffered writer for large outputs, formats integers without fprintf
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;
+} dc_writer;
+
+#define DC_WRITER_SIZE (1<<16)
+
+// Writer initialization
+dc_writer *dc_writer_init(FILE *fp);
+// Writes a string
+void dc_writer_str(dc_writer *wr, const char *str);
+// Writes a single character
+void dc_writer_char(dc_writer *wr, char c);
+// Writes an integer in decimal
+void dc_writer_int(dc_writer *wr, int x);
+// Writes a double as "%lf" does
+void dc_writer_double(dc_writer *wr, double x);
+// Writes the buffered data and frees the writer
+void dc_writer_free(dc_writer *wr);
+
 // Memory usage
 void get_memory_usage(int* currRealMem, int* peakRealMem, int* currVirtMem, int* peakVirtMem);
 
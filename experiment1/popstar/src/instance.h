@@ -37,6 +37,7 @@ class PMInstance {
 		virtual double getOracleTime() =  0;
 		virtual double getFacDist (int f, int g) = 0;
 		virtual double getFacCost (int f) = 0; //{return 0;}
+		virtual double getWeight (int u) {return 1.0;} //number of original users represented by u (distances already include it)
 		virtual bool fixedP () {return true;} //pmedian-> true ; facloc->false
 		virtual void outputParameters(FILE *file) {
 			fprintf (file, "users %d\n", getN());
@@ -20,6 +20,7 @@ void PMMatrixInstance::reset() {
 	d = NULL;       //distance matrix
 	n = p = m = 0;  //cities, facilities, potential facilites: all zero
 	fc = NULL;      //facility weights
+	w = NULL;       //user weights
 }
 
 
@@ -56,6 +57,13 @@ PMMatrixInstance::PMMatrixInstance (PMInstance *original, int *of, int *oc) {
 		}
 	}
 
+	//-------------
+	// set weights
+	//-------------
+	w = new double [n+1];
+	w[0] = 0;
+	for (c=1; c<=n; c++) w[c] = original->getWeight(oc[c]);
+
 	initOracle();
 }
 
@@ -219,11 +227,63 @@ void PMMatrixInstance::readUFL (FILE *input) {
 		fprintf (stderr, "WARNING: error in input file (%d edges announced, %d read)\n", 
 				e_announced, e_count);
 	}
-	
+
+	mergeUsers();
 	initOracle();
 }
 
 
+/*-----------------------------------------------------------
+ | mergeUsers: users whose distances to all the facilities
+ | are the same are merged into a single user, whose weight
+ | is the number of users merged; its distances are
+ | multiplied by the weight, so solution costs are the same
+ | (only for facility location, facilities are not users)
+ *----------------------------------------------------------*/
+
+void PMMatrixInstance::mergeUsers() {
+	int u, f, k;
+	w = new double [n+1];
+	w[0] = 0;
+
+	//open addressing table of the distinct users found so far
+	int size = 1;
+	while (size < 2*n) size *= 2;
+	int *table = new int [size];
+	for (k=0; k<size; k++) table[k] = 0;
+
+	int newn = 0;
+	for (u=1; u<=n; u++) {
+		//FNV-1a hash of the distances of the user
+		unsigned long long h = 14695981039346656037ULL;
+		const unsigned char *bytes = (const unsigned char *)(d[u]+1);
+		for (k=0; k<(int)(m*sizeof(double)); k++) h = (h ^ bytes[k]) * 1099511628211ULL;
+		k = (int)(h & (size-1));
+		while (table[k]!=0 && memcmp(d[table[k]]+1, d[u]+1, m*sizeof(double))!=0) k = (k+1) & (size-1);
+
+		if (table[k]==0) {
+			//new user: move its row to the first free position (rows between them are duplicates)
+			newn ++;
+			double *tmp = d[newn]; d[newn] = d[u]; d[u] = tmp;
+			table[k] = newn;
+			w[newn] = 1;
+		} else w[table[k]] += 1;
+	}
+	delete [] table;
+
+	//scale distances and get rid of the duplicates
+	for (u=1; u<=newn; u++) {
+		if (w[u]==1) continue;
+		for (f=1; f<=m; f++) {
+			if (d[u][f] < POPSTAR_INFINITY) d[u][f] *= w[u];
+		}
+	}
+	for (u=newn+1; u<=n; u++) delete [] d[u];
+	if (newn < n) fprintf (stderr, "Merged %d users with the same distances (%d left).\n", n-newn, newn);
+	n = newn;
+}
+
+
 /*******************************************
  *
  * destructor: deallocates distance matrix,
@@ -237,5 +297,6 @@ PMMatrixInstance::~PMMatrixInstance() {
 		delete [] d;
 	}
 	if (fc!=NULL) delete [] fc;
+	if (w!=NULL) delete [] w;
 	delete oracle;
 }
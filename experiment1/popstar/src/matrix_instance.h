@@ -31,6 +31,8 @@ class PMMatrixInstance:public PMInstance {
 		void initOracle() {oracle = new PMDistanceOracle (this);}
 		double **d; //distance matrix
 		double *fc; //facility cost
+		double *w;  //user weights (NULL if all users have weight 1)
+		void mergeUsers();
 		int n; //number of nodes (users)
 		int p; //number of facilities we are aiming for
 		int m; //number of potential facilities
@@ -91,6 +93,7 @@ class PMMatrixInstance:public PMInstance {
 
 
 		virtual double getFacCost(int f) {return (fc==NULL) ? 0 : fc[f];}
+		virtual double getWeight(int u) {return (w==NULL) ? 1.0 : w[u];}
 		virtual int  getM() {return m;} 
 		virtual int  getN() {return n;}
 		virtual int  getP() {return p;}
@@ -0,0 +1,304 @@
+import sys
+import os
+
+import re
+import csv
+import time
+import argparse
+import subprocess
+
+"""
+Regression and performance harness, runs a matrix of dc2 configurations and POPSTAR
+on the problems of problems_test and on some generated Koerkel-Ghosh instances.
+
+Each solution given by dc2 is checked with opt_checker, and the values, CPU time,
+elapsed time, peak memory and iterations of each run are compared against a CSV baseline.
+Everything runs in a single thread with fixed seeds, so the values and iterations must be
+the same as the ones of the baseline, while the times and memory are compared with a tolerance.
+The peak memory is the virtual memory peak that dc2 reports, POPSTAR doesn't report it.
+
+It also checks that branch and bound doesn't prune optimal solutions when the
+preprocessing fixes facilities: on small instances that are solved exhaustively,
+-pre -bnb must give the value of -pre, and its bound must not be below it.
+
+usage: python3 regression_test.py [--update] [--tolerance <frac>] [--seeds <s1,s2,..>] [--only <name1,name2,..>]
+(the name of the -pre -bnb checks for --only is pre-bnb)
+"""
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+DC = os.path.join(HERE,"dc2/bin/dc")
+OPT_CHECKER = os.path.join(HERE,"dc2/bin/opt_checker")
+POPSTAR_DIR = os.path.join(HERE,"experiment1/popstar/src")
+POPSTAR = os.path.join(POPSTAR_DIR,"popstar")
+KGGEN_SRC = os.path.join(HERE,"experiment1/koerkel_ghosh/kggensym.c")
+CONVERTER = os.path.join(HERE,"experiment1/simple2ufl_converter.py")
+
+DEFAULT_BASELINE = os.path.join(HERE,"regression_baseline.csv")
+WORKDIR = os.path.join(HERE,"tmp/regression")
+
+# Instances on problems_test
+TEST_PROBLEMS = ["problems_test/ga750a-1","problems_test/ga750a-2"]
+
+# Generated instances, as in generate_kg_problems.sh: (prefix, size, f_lo, f_hi, c_lo, c_hi, n_problems)
+GENERATED_PROBLEMS = [
+    ("kg_250a-", 250,   100,   200, 1000, 2000, 1),
+    ("kg_250b-", 250,  1000,  2000, 1000, 2000, 1),
+    ("kg_500c-", 500, 10000, 20000, 1000, 2000, 1),
+]
+
+# Configurations, based on the strategies of experiment1_searches_solve.sh, with smaller pools.
+# The seed is given as {seed}.
+CONFIGS = [
+    ("grasp10",          "dc",      "-V -W -t1 -r{seed} -R20 best:10 rand:1"),
+    ("sdbsp-mgesum",     "dc",      "-V -W -t1 -r{seed} -B8 sdbs+:10:mgesum"),
+    ("vr",               "dc",      "-V -W -t1 -r{seed} -B8 vrh:10:pcd"),
+    ("rand8",            "dc",      "-V -W -t1 -r{seed} -B8 rand:10"),
+    ("sdbsp-mgesum-pr",  "dc",      "-V -W -t1 -r{seed} -M -B8 sdbs+:10:mgesum _best:10"),
+    ("rand8-pr",         "dc",      "-V -W -t1 -r{seed} -M -B8 rand:10 _best:10"),
+    ("popstar-S",        "popstar", "-graspit 16 -elite 10 -seed {seed}"),
+]
+
+# Small instances for the exhaustive checks of -pre -bnb, their low facility costs let the preprocessing fix facilities
+PRE_BNB_PROBLEMS = [
+    ("kgfix_16a-", 16, 100, 200, 1000, 2000, 4),
+]
+# Keeps all the solutions of each size of 16 facilities, so the search is exhaustive
+PRE_BNB_ARGS = "-V -t1 {ls} -pre best:70000"
+PRE_BNB_LOCAL_SEARCHES = ["-W","-w"]
+
+FIELDS = ["instance","config","seed","value","cpu_time","elapsed","peak_mem_kb","iterations"]
+
+# Performance differences smaller than these are considered noise
+MIN_DELTA_SECONDS = 0.2
+MIN_DELTA_MEM_KB = 8192
+
+# Regular expressions
+dc2_value = re.compile(r'# VALUE:\s+(\S+)')
+dc2_assigns = re.compile(r'# ASSIGNS:\s+(.*)')
+dc2_iterations = re.compile(r'# TOTAL_ITERATIONS:\s+(\S+)')
+dc2_mem_peak = re.compile(r'# VIRT_MEM_PEAK_KB:\s+(\S+)')
+dc2_upper_bound = re.compile(r'# UPPER_BOUND:\s+(\S+)')
+dc2_fixed = re.compile(r'# PREPROCESSING_FIXED_FACILITIES:\s+(\S+)')
+popstar_bestsol = re.compile(r'bestsol (\S+)')
+popstar_graspit = re.compile(r'graspit (\S+)')
+
+
+def run_measured(cmd, stdout):
+    """ Runs a command, returning its CPU time and elapsed time """
+    # NOTE: ru_maxrss isn't used for the memory, as it counts the one of this process when it was forked.
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd,stdout=stdout,stderr=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid,0)
+    elapsed = time.monotonic()-start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode!=0:
+        raise RuntimeError("command failed (%d): %s"%(proc.returncode," ".join(cmd)))
+    return usage.ru_utime+usage.ru_stime, elapsed
+
+
+def prepare_binaries(use_popstar):
+    for binary in [DC,OPT_CHECKER]:
+        if not os.path.isfile(binary):
+            print("ERROR: %s not found, compile dc2 first with make."%binary)
+            sys.exit(1)
+    if use_popstar and not os.path.isfile(POPSTAR):
+        print("Compiling POPSTAR...")
+        if subprocess.call(["make","-s","-C",POPSTAR_DIR],stdout=subprocess.DEVNULL)!=0:
+            print("WARNING: couldn't compile POPSTAR, its runs are skipped.")
+            return False
+    return use_popstar
+
+
+def prepare_instances(generated=GENERATED_PROBLEMS, test_problems=TEST_PROBLEMS):
+    instances = [os.path.join(HERE,p) for p in test_problems]
+    # Generate the KG instances, the generator uses a fixed seed
+    gendir = os.path.join(WORKDIR,"instances")
+    os.makedirs(gendir,exist_ok=True)
+    kggen = os.path.join(gendir,"genprob_sym")
+    subprocess.check_call(["gcc","-O2",KGGEN_SRC,"-o",kggen])
+    for prefix,size,f_lo,f_hi,c_lo,c_hi,n_probs in generated:
+        args = [str(x) for x in [size,size,f_lo,f_hi,c_lo,c_hi]]
+        subprocess.check_call([kggen]+args+[os.path.join(gendir,prefix),str(n_probs)],stdout=subprocess.DEVNULL)
+        for i in range(1,n_probs+1):
+            instances.append(os.path.join(gendir,prefix+str(i)))
+    return instances
+
+
+def check_dc_solution(instance, output, value):
+    """ Recomputes the value of the first solution of a dc2 output with opt_checker """
+    with open(output) as fo:
+        assigns = dc2_assigns.findall(fo.read())[0]
+    opt_fname = output+".opt"
+    with open(opt_fname,"w") as fo:
+        fo.write(assigns+"\n")
+    res = subprocess.run([OPT_CHECKER,instance,opt_fname],capture_output=True,text=True)
+    if res.returncode!=0:
+        return "opt_checker failed: "+res.stderr.strip()
+    checked = float(res.stdout.split()[-1])
+    if abs(checked-value)>1e-6*max(1.0,abs(value)):
+        return "value %f doesn't match opt_checker's %f"%(value,checked)
+    return None
+
+
+def run_config(instance, config, seed):
+    name, solver, args = config
+    args = args.format(seed=seed).split()
+    output = os.path.join(WORKDIR,"out",name+"_"+str(seed)+"_"+os.path.basename(instance))
+    os.makedirs(os.path.dirname(output),exist_ok=True)
+    if solver=="dc":
+        cpu, elapsed = run_measured([DC]+args+[instance,output],subprocess.DEVNULL)
+        with open(output) as fo:
+            txt = fo.read()
+        # Values are stored as costs, like on the .opt files
+        value = -float(dc2_value.findall(txt)[0])
+        iterations = int(dc2_iterations.findall(txt)[0])
+        mem = int(dc2_mem_peak.findall(txt)[0])
+        error = check_dc_solution(instance,output,value)
+    else:
+        ufl = os.path.join(WORKDIR,"instances",os.path.basename(instance)+".ufl")
+        if not os.path.isfile(ufl):
+            subprocess.check_call([sys.executable,CONVERTER,instance,ufl])
+        with open(output,"w") as fo:
+            cpu, elapsed = run_measured([POPSTAR,ufl]+args,fo)
+        with open(output) as fo:
+            txt = fo.read()
+        value = float(popstar_bestsol.findall(txt)[0])
+        iterations = int(popstar_graspit.findall(txt)[0])
+        mem = ""
+        error = None
+    row = {
+        "instance": os.path.relpath(instance,HERE) if instance.startswith(HERE+"/problems_test") else os.path.basename(instance),
+        "config": name,
+        "seed": seed,
+        "value": "%.6f"%value,
+        "cpu_time": "%.3f"%cpu,
+        "elapsed": "%.3f"%elapsed,
+        "peak_mem_kb": mem,
+        "iterations": iterations,
+    }
+    return row, error
+
+
+def check_pre_bnb(instance, ls):
+    """ Compares -pre -bnb against -pre on an instance that is solved exhaustively, returns (n_fixed, problems) """
+    results = []
+    for bnb in ["","-bnb"]:
+        args = PRE_BNB_ARGS.format(ls=ls).split()+([bnb] if bnb else [])
+        output = os.path.join(WORKDIR,"out","prebnb"+bnb+ls+"_"+os.path.basename(instance))
+        os.makedirs(os.path.dirname(output),exist_ok=True)
+        run_measured([DC]+args+[instance,output],subprocess.DEVNULL)
+        with open(output) as fo:
+            txt = fo.read()
+        value = -float(dc2_value.findall(txt)[0])
+        error = check_dc_solution(instance,output,value)
+        results.append((value,txt,error))
+    (value, txt, error), (bnb_value, bnb_txt, bnb_error) = results
+    problems = ["CHECK "+e for e in [error,bnb_error] if e is not None]
+    if abs(bnb_value-value)>1e-6*max(1.0,abs(value)):
+        problems.append("VALUE -bnb %f != %f"%(bnb_value,value))
+    # The bound is reported for the value, the values here are costs
+    bound = -float(dc2_upper_bound.findall(bnb_txt)[0])
+    if bound>value+1e-6*max(1.0,abs(value)):
+        problems.append("CHECK bound %f above the optimal cost %f"%(bound,value))
+    fixed = dc2_fixed.findall(bnb_txt)
+    return (int(fixed[0]) if fixed else 0), value, problems
+
+
+def compare(row, base, tolerance):
+    """ Returns the list of regressions of a row compared with its baseline """
+    problems = []
+    # Improvements are also failures, the baseline must be updated after an intended change
+    value, base_value = float(row["value"]), float(base["value"])
+    if abs(value-base_value)>1e-6*max(1.0,abs(base_value)):
+        problems.append("VALUE %s != %s"%(row["value"],base["value"]))
+    if int(row["iterations"])!=int(base["iterations"]):
+        problems.append("ITERATIONS %s != %s"%(row["iterations"],base["iterations"]))
+    for field,min_delta in [("cpu_time",MIN_DELTA_SECONDS),("elapsed",MIN_DELTA_SECONDS),("peak_mem_kb",MIN_DELTA_MEM_KB)]:
+        # Not measured (the memory of POPSTAR)
+        if str(row[field])=="" or str(base[field])=="": continue
+        new, old = float(row[field]), float(base[field])
+        if new>old*(1+tolerance) and new-old>min_delta:
+            problems.append("PERF %s %s > %s (+%.0f%%)"%(field,row[field],base[field],100*(new/old-1)))
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Regression and performance harness for dc2.")
+    parser.add_argument("--update",action="store_true",help="save the results as the new baseline")
+    parser.add_argument("--baseline",default=DEFAULT_BASELINE,help="baseline CSV file")
+    parser.add_argument("--tolerance",type=float,default=0.25,help="allowed relative increase of times and memory")
+    parser.add_argument("--seeds",default="1",help="comma separated random seeds")
+    parser.add_argument("--only",default=None,help="comma separated configurations to run")
+    args = parser.parse_args()
+
+    configs = CONFIGS
+    if args.only is not None:
+        names = args.only.split(",")
+        configs = [c for c in CONFIGS if c[0] in names]
+    use_popstar = prepare_binaries(any(c[1]=="popstar" for c in configs))
+    if not use_popstar:
+        configs = [c for c in configs if c[1]!="popstar"]
+    seeds = [int(s) for s in args.seeds.split(",")]
+
+    baseline = {}
+    if os.path.isfile(args.baseline) and not args.update:
+        with open(args.baseline) as fo:
+            for row in csv.DictReader(fo):
+                baseline[(row["instance"],row["config"],int(row["seed"]))] = row
+    elif not args.update:
+        print("WARNING: no baseline on %s, run with --update to create it."%args.baseline)
+
+    instances = prepare_instances()
+
+    # Run the matrix
+    rows = []
+    n_failures = 0
+    for instance in instances:
+        for config in configs:
+            for seed in seeds:
+                row, error = run_config(instance,config,seed)
+                rows.append(row)
+                problems = [] if error is None else ["CHECK "+error]
+                base = baseline.get((row["instance"],row["config"],seed))
+                if base is not None:
+                    problems += compare(row,base,args.tolerance)
+                failed = len(problems)>0
+                n_failures += failed
+                print("%-4s %-24s %-18s %3d %16s %8ss %8ss %8skB %6s %s"%(
+                    "FAIL" if failed else "ok",row["instance"],row["config"],seed,row["value"],
+                    row["cpu_time"],row["elapsed"],row["peak_mem_kb"],row["iterations"],"; ".join(problems)))
+                sys.stdout.flush()
+
+    # Exhaustive checks of -pre -bnb
+    n_checks = 0
+    if args.only is None or "pre-bnb" in args.only.split(","):
+        total_fixed = 0
+        for instance in prepare_instances(PRE_BNB_PROBLEMS,[]):
+            for ls in PRE_BNB_LOCAL_SEARCHES:
+                n_fixed, value, problems = check_pre_bnb(instance,ls)
+                total_fixed += n_fixed
+                failed = len(problems)>0
+                n_failures += failed
+                n_checks += 1
+                print("%-4s %-24s %-18s %3s %16s %2d fixed %s"%("FAIL" if failed else "ok",os.path.basename(instance),
+                    "pre-bnb"+ls,"",("%.6f"%value),n_fixed,"; ".join(problems)))
+                sys.stdout.flush()
+        if total_fixed==0:
+            print("WARNING: the preprocessing fixed no facilities, -pre -bnb wasn't tested with them.")
+
+    # Save results
+    results_fname = args.baseline if args.update else os.path.join(WORKDIR,"results.csv")
+    with open(results_fname,"w",newline="") as fo:
+        writer = csv.DictWriter(fo,fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+    print("Results saved on %s."%results_fname)
+
+    if n_failures>0:
+        print("%d of %d runs have regressions."%(n_failures,len(rows)+n_checks))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()